@@ -1,8 +1,11 @@
 #include "chart.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <format>
+#include <limits>
+#include <numeric>
 #include <optional>
 #include <ranges>
 #include <span>
@@ -21,6 +24,10 @@ static constexpr int    W = int(VW * OUT_SCALE), H = int(VH * OUT_SCALE);
 static constexpr int ML = 80, MR = 24, MT = 44, MB = 56;
 static constexpr int LEG_W = 240;
 
+// Above these counts, x ticks are spread evenly instead of one per x, and points aren't marked.
+static constexpr size_t MAX_X_TICKS = 32;
+static constexpr size_t MAX_MARKERS = 64;
+
 static constexpr string_view FONT = "ui-sans-serif, system-ui, -apple-system, Segoe UI, Roboto, Arial";
 static constexpr string_view BG   = "#ffffff";
 static constexpr string_view FG   = "#111827"; // slate-900
@@ -88,23 +95,92 @@ static vector<int> all_xs(span<const series> ss) {
     return xs;
 }
 
+// Largest y, including the upper end of the spread.
 static double max_y(span<const series> ss) {
     double m = 0.0;
     for(auto & s : ss)
         for(auto & p : s.pts)
             if(p.y)
-                m = max(m, *p.y);
+                m = max({m, *p.y, p.hi.value_or(0.0)});
     return m;
 }
 
-static optional<double> y_at(span<const point> pts, int x) {
-    for(auto & p : pts)
-        if(p.x == x)
-            return p.y;
-    return nullopt;
+// Smallest positive y, including the lower end of the spread; the bottom of a log axis.
+static double min_positive_y(span<const series> ss) {
+    double m = numeric_limits<double>::infinity();
+    for(auto & s : ss)
+        for(auto & p : s.pts)
+            for(auto y : {p.y, p.lo})
+                if(y && *y > 0.0)
+                    m = min(m, *y);
+    return isinf(m) ? 1.0 : m;
+}
+
+// The point of `s` at each of the sorted `xs` (or nullptr), so lookups don't have to scan the series.
+static vector<const point *> aligned(const series & s, span<const int> xs) {
+    vector<const point *> col(xs.size(), nullptr);
+    for(auto & p : s.pts)
+        if(const auto it = ranges::lower_bound(xs, p.x); it != xs.end() && *it == p.x)
+            col[size_t(it - xs.begin())] = &p;
+    return col;
+}
+
+// Largest-Triangle-Three-Buckets: indices of the `n` points that best keep the visual shape of the polyline.
+static vector<size_t> lttb(span<const pair<double, double>> pts, size_t n) {
+    vector<size_t> keep;
+    if(n >= pts.size()) {
+        keep.resize(pts.size());
+        iota(begin(keep), end(keep), size_t{0});
+        return keep;
+    }
+    if(n < 3) // no bucket between the endpoints
+        return {0, pts.size() - 1};
+
+    const double every = double(pts.size() - 2) / double(n - 2);
+    size_t       a     = 0;
+    keep.push_back(a);
+    for(size_t i = 0; i < n - 2; ++i) {
+        // Average of the next bucket is the third vertex of the triangle.
+        const size_t next_lo = size_t(double(i + 1) * every) + 1;
+        const size_t next_hi = min(size_t(double(i + 2) * every) + 1, pts.size());
+        double       ax = 0.0, ay = 0.0;
+        for(size_t j = next_lo; j < next_hi; ++j) {
+            ax += pts[j].first;
+            ay += pts[j].second;
+        }
+        ax /= double(max<size_t>(next_hi - next_lo, 1));
+        ay /= double(max<size_t>(next_hi - next_lo, 1));
+
+        const size_t lo   = size_t(double(i) * every) + 1;
+        const size_t hi   = size_t(double(i + 1) * every) + 1;
+        double       best = -1.0;
+        size_t       pick = lo;
+        for(size_t j = lo; j < hi; ++j) {
+            const double area = abs((pts[a].first - ax) * (pts[j].second - pts[a].second) -
+                                    (pts[a].first - pts[j].first) * (ay - pts[a].second));
+            if(area > best) {
+                best = area;
+                pick = j;
+            }
+        }
+        keep.push_back(a = pick);
+    }
+    keep.push_back(pts.size() - 1);
+    return keep;
+}
+
+// 1, 2 or 5 times a power of ten, no smaller than `raw`.
+static double nice_step(double raw) {
+    const double p = pow(10.0, floor(log10(raw)));
+    for(double m : {1.0, 2.0, 5.0})
+        if(m * p >= raw)
+            return m * p;
+    return 10.0 * p;
 }
 
-string svg_lines(span<const series> ss, string_view title) {
+static string fmt_tick(double y) { return y >= 1.0 || y == 0.0 ? format("{:.0f}", y) : format("{:.2g}", y); }
+
+string svg_lines(span<const series> ss, string_view title, const options & o) {
     const auto xs = all_xs(ss);
     const auto my = max_y(ss);
     const int  PL = ML;
@@ -121,7 +197,12 @@ string svg_lines(span<const series> ss, string_view title) {
             return PL + PW * 0.5;
         return PL + (double(x - xmin) / double(xmax - xmin)) * PW;
     };
-    auto y2py = [&](double y) -> double {
+    // Log axis spans whole decades.
+    const double ldmin = floor(log10(min_positive_y(ss)));
+    const double ldmax = max(ceil(log10(max(my, 1e-300))), ldmin + 1.0);
+    auto         y2py  = [&](double y) -> double {
+        if(o.log_y)
+            return PT + (1.0 - (log10(max(y, pow(10.0, ldmin))) - ldmin) / (ldmax - ldmin)) * PH;
         if(my <= 0.0)
             return PT + PH;
         return PT + (1.0 - (y / my)) * PH;
@@ -130,8 +211,10 @@ string svg_lines(span<const series> ss, string_view title) {
     string s;
     s.reserve(size_t(H) * 24);
 
-    (void)title; // header is standardized for this benchmark
-    const auto t = esc(format("lang_benchmark: time to \"compile\" {} functions", fmt_count(xmax)));
+    // The header is standardized for the compile time charts; the others are named by their title.
+    const auto t = esc(o.compile_header
+                         ? format("lang_benchmark: time to \"compile\" {} functions", fmt_count(xmax))
+                         : format("lang_benchmark: {}", title));
 
     s += format(
       R"svg(<svg xmlns="http://www.w3.org/2000/svg" width="{}" height="{}" viewBox="0 0 {} {}" role="img" aria-label="{}">
@@ -184,12 +267,21 @@ string svg_lines(span<const series> ss, string_view title) {
                 PL,
                 PT + PH);
 
-    // y grid ticks (0/25/50/75/100%)
-    for(int k : {0, 1, 2, 3, 4}) {
-        const double y  = my * (double(k) / 4.0);
+    // y grid ticks: 0/25/50/75/100%, or decades (with 2x and 5x when there are few) on a log axis
+    vector<double> y_ticks;
+    if(o.log_y) {
+        for(double d = ldmin; d <= ldmax; ++d)
+            for(double m : {1.0, 2.0, 5.0})
+                if(m == 1.0 || ldmax - ldmin <= 3.0)
+                    if(d < ldmax || m == 1.0)
+                        y_ticks.push_back(m * pow(10.0, d));
+    } else
+        for(int k : {0, 1, 2, 3, 4})
+            y_ticks.push_back(my * (double(k) / 4.0));
+    for(const double y : y_ticks) {
         const double py = y2py(y);
         s += format(R"svg(<line class="g" x1="{}" y1="{}" x2="{}" y2="{}"/>
-<text class="a" x="{}" y="{}" text-anchor="end">{:.0f}</text>
+<text class="a" x="{}" y="{}" text-anchor="end">{}</text>
 )svg",
                     PL,
                     py,
@@ -197,11 +289,18 @@ string svg_lines(span<const series> ss, string_view title) {
                     py,
                     PL - 10,
                     py + 4,
-                    y);
+                    fmt_tick(y));
     }
 
-    // x ticks: each measured num_fns
-    for(int x : xs) {
+    // x ticks: each measured num_fns, or evenly spread for dense sweeps
+    vector<int> x_ticks = xs;
+    if(xs.size() > MAX_X_TICKS) {
+        const double step = nice_step(double(xmax - xmin) / 10.0);
+        x_ticks.clear();
+        for(double x = ceil(xmin / step) * step; x <= xmax; x += step)
+            x_ticks.push_back(int(x));
+    }
+    for(int x : x_ticks) {
         const double px = x2px(x);
         s += format(R"svg(<line class="g" x1="{}" y1="{}" x2="{}" y2="{}"/>
 <text class="a" x="{}" y="{}" text-anchor="middle">{}</text>
@@ -215,42 +314,94 @@ string svg_lines(span<const series> ss, string_view title) {
                     fmt_count(x));
     }
 
-    // lines + points
+    // Each series is drawn as runs of consecutive measured points, downsampled to at most o.max_points.
+    struct run {
+        vector<const point *>        pts;
+        vector<pair<double, double>> px;
+    };
+    vector<vector<run>> runs_by_series;
     for(auto & se : ss) {
-        string path;
-        bool   pen = false;
-        for(int x : xs) {
-            const auto y = y_at(se.pts, x);
-            if(!y) {
+        auto & runs = runs_by_series.emplace_back();
+        bool   pen  = false;
+        for(size_t c = 0; const auto * p : aligned(se, xs)) {
+            const int x = xs[c++];
+            if(!p || !p->y || (o.log_y && *p->y <= 0.0)) {
                 pen = false;
                 continue;
             }
-            const auto px = x2px(x);
-            const auto py = y2py(*y);
-            path += format("{}{:.2f},{:.2f} ", pen ? "L" : "M", px, py);
+            if(!pen)
+                runs.emplace_back();
+            runs.back().pts.push_back(p);
+            runs.back().px.push_back({x2px(x), y2py(*p->y)});
             pen = true;
         }
 
+        size_t total = 0;
+        for(auto & r : runs)
+            total += r.pts.size();
+        if(!o.max_points || total <= o.max_points)
+            continue;
+        for(auto & r : runs) {
+            const size_t budget = max<size_t>(2, o.max_points * r.pts.size() / total);
+            run          kept;
+            for(size_t k : lttb(r.px, budget)) {
+                kept.pts.push_back(r.pts[k]);
+                kept.px.push_back(r.px[k]);
+            }
+            r = std::move(kept);
+        }
+    }
+
+    // spread bands, below all lines
+    for(size_t si = 0; si < ss.size(); ++si) {
+        for(auto & r : runs_by_series[si]) {
+            string band, back;
+            for(size_t k = 0; k < r.pts.size(); ++k) {
+                const auto & p = *r.pts[k];
+                if(!p.lo || !p.hi)
+                    continue;
+                band += format("{}{:.2f},{:.2f} ", band.empty() ? "M" : "L", r.px[k].first, y2py(*p.hi));
+                back = format("L{:.2f},{:.2f} ", r.px[k].first, y2py(*p.lo)) + back;
+            }
+            if(!band.empty())
+                s += format(R"svg(<path d="{}{}Z" fill="{}" fill-opacity=".15" stroke="none"/>
+)svg",
+                            band,
+                            back,
+                            ss[si].color);
+        }
+    }
+
+    // lines + points
+    for(size_t si = 0; si < ss.size(); ++si) {
+        const auto & se     = ss[si];
+        const auto & runs   = runs_by_series[si];
+        string       path;
+        size_t       points = 0;
+        for(auto & r : runs) {
+            for(size_t k = 0; k < r.px.size(); ++k)
+                path += format("{}{:.2f},{:.2f} ", k ? "L" : "M", r.px[k].first, r.px[k].second);
+            points += r.px.size();
+        }
+
         if(!path.empty()) {
             s += format(
-              R"svg(<path d="{}" fill="none" stroke="{}" stroke-width="2.4" stroke-linecap="round" stroke-linejoin="round"/>
+              R"svg(<path d="{}" fill="none" stroke="{}" stroke-width="2.4" stroke-linecap="round" stroke-linejoin="round"{}/>
 )svg",
               path,
-              se.color);
+              se.color,
+              se.dashed ? R"svg( stroke-dasharray="7 5")svg" : "");
         }
 
-        for(int x : xs) {
-            const auto y = y_at(se.pts, x);
-            if(!y)
-                continue;
-            const auto px = x2px(x);
-            const auto py = y2py(*y);
-            s += format(R"svg(<circle cx="{:.2f}" cy="{:.2f}" r="3.4" fill="{}" />
+        if(points > MAX_MARKERS)
+            continue;
+        for(auto & r : runs)
+            for(auto & [px, py] : r.px)
+                s += format(R"svg(<circle cx="{:.2f}" cy="{:.2f}" r="3.4" fill="{}" />
 )svg",
-                        px,
-                        py,
-                        se.color);
-        }
+                            px,
+                            py,
+                            se.color);
     }
 
     // legend (embedded inside plot, top-left)
@@ -269,11 +420,13 @@ string svg_lines(span<const series> ss, string_view title) {
 
     int ly = ly0;
     for(auto & se : ss) {
-        s += format(R"svg(<rect x="{}" y="{}" width="10" height="10" rx="2" fill="{}"/>
+        // Dashed series get a hollow swatch.
+        s += format(R"svg(<rect x="{}" y="{}" width="10" height="10" rx="2" fill="{}" stroke="{}"/>
 <text class="l" x="{}" y="{}">{}</text>
 )svg",
                     lx0,
                     ly,
+                    se.dashed ? "none" : se.color,
                     se.color,
                     lx0 + 16,
                     ly + 10,
@@ -282,24 +435,29 @@ string svg_lines(span<const series> ss, string_view title) {
     }
 
     // axis labels
-    s += format(R"svg(<text class="a" x="{}" y="{}" text-anchor="end">ms</text>
-<text class="a" x="{}" y="{}" text-anchor="end">functions</text>
+    const auto y_label = o.log_y ? format("{} (log)", o.y_unit) : string{o.y_unit};
+    s += format(R"svg(<text class="a" x="{}" y="{}" text-anchor="end">{}</text>
+<text class="a" x="{}" y="{}" text-anchor="end">{}</text>
 )svg",
-                PL + 20,
+                PL + 12 + 4 * int(y_label.size()),
                 PT - 10,
+                esc(y_label),
                 PL + PW,
-                PT + PH + 44);
+                PT + PH + 44,
+                esc(o.x_unit));
 
     s += "</svg>\n";
     return s;
 }
 
-string md_pivot(span<const series> ss, string_view caption, string_view unit) {
+string md_pivot(span<const series> ss, string_view caption, string_view unit, string_view note) {
     const auto xs = all_xs(ss);
     string     s;
     if(!caption.empty())
         s += format("{}\n\n", caption);
-    if(!unit.empty())
+    if(!note.empty())
+        s += format("_{}_\n\n", note);
+    else if(!unit.empty())
         s += format("_Time in {} (lower is better)_\n\n", unit);
 
     s += "| Language |";
@@ -312,10 +470,9 @@ string md_pivot(span<const series> ss, string_view caption, string_view unit) {
 
     for(auto & se : ss) {
         s += format("| {} |", se.label);
-        for(int x : xs) {
-            const auto y = y_at(se.pts, x);
-            if(y)
-                s += format(" {:.3f} |", *y);
+        for(const auto * p : aligned(se, xs)) {
+            if(p && p->y)
+                s += format(" {:.3f} |", *p->y);
             else
                 s += " N/A |";
         }
@@ -324,4 +481,167 @@ string md_pivot(span<const series> ss, string_view caption, string_view unit) {
     return s;
 }
 
+// Viridis, sampled at five stops; t in [0, 1].
+static string viridis(double t) {
+    static constexpr array<array<double, 3>, 5> STOPS = {{
+      {68, 1, 84},
+      {59, 82, 139},
+      {33, 145, 140},
+      {94, 201, 98},
+      {253, 231, 37},
+    }};
+    const double x = clamp(t, 0.0, 1.0) * double(STOPS.size() - 1);
+    const size_t i = min(size_t(x), STOPS.size() - 2);
+    const double f = x - double(i);
+    auto         c = [&](size_t k) { return int(lround(STOPS[i][k] + (STOPS[i + 1][k] - STOPS[i][k]) * f)); };
+    return format("#{:02x}{:02x}{:02x}", c(0), c(1), c(2));
+}
+
+string svg_heatmap(const grid & g, string_view title) {
+    static constexpr int LEGEND_W = 16, LEGEND_GAP = 24;
+
+    const size_t cols = g.xs.size(), rows = g.ys.size();
+    const int    PL = ML, PT = MT, PB = MB, PR = MR + LEGEND_GAP + LEGEND_W + 64;
+    const int    PW = VW - PL - PR, PH = VH - PT - PB;
+    const double cw = cols ? double(PW) / double(cols) : 0.0, ch = rows ? double(PH) / double(rows) : 0.0;
+
+    double lo = numeric_limits<double>::infinity(), hi = 0.0;
+    for(auto & v : g.values)
+        if(v && *v > 0.0) {
+            lo = min(lo, *v);
+            hi = max(hi, *v);
+        }
+    if(isinf(lo))
+        lo = hi = 1.0;
+    auto shade = [&](double v) {
+        return hi > lo ? (log10(max(v, lo)) - log10(lo)) / (log10(hi) - log10(lo)) : 0.5;
+    };
+
+    const auto t = esc(format("lang_benchmark: {}", title));
+    string     s;
+    s += format(
+      R"svg(<svg xmlns="http://www.w3.org/2000/svg" width="{}" height="{}" viewBox="0 0 {} {}" role="img" aria-label="{}">
+<rect x="0" y="0" width="{}" height="{}" fill="{}"/>
+<style>
+:root{{font-family:{};}}
+.t{{fill:{};font-size:16px;font-weight:650;}}
+.a{{fill:{};font-size:12px;}}
+.v{{font-size:11px;}}
+</style>
+<text class="t" x="{}" y="{}">{}</text>
+)svg",
+      W,
+      H,
+      VW,
+      VH,
+      t,
+      VW,
+      VH,
+      BG,
+      FONT,
+      FG,
+      SUB,
+      PL,
+      28,
+      t);
+
+    // Rows grow upwards, like the y axis of the line charts.
+    const bool labels = cols <= 16 && ch >= 18.0;
+    for(size_t r = 0; r < rows; ++r) {
+        const double y = PT + PH - double(r + 1) * ch;
+        for(size_t c = 0; c < cols; ++c) {
+            const double x = PL + double(c) * cw;
+            const auto & v = g.values[r * cols + c];
+            s += format(R"svg(<rect x="{:.1f}" y="{:.1f}" width="{:.1f}" height="{:.1f}" fill="{}" stroke="{}"/>
+)svg",
+                        x,
+                        y,
+                        cw,
+                        ch,
+                        v ? viridis(shade(*v)) : GRID,
+                        BG);
+            if(labels)
+                s += format(R"svg(<text class="v" x="{:.1f}" y="{:.1f}" text-anchor="middle" fill="{}">{}</text>
+)svg",
+                            x + cw * 0.5,
+                            y + ch * 0.5 + 4,
+                            v && shade(*v) > 0.6 ? FG : BG,
+                            v ? fmt_tick(*v) : "N/A");
+        }
+        s += format(R"svg(<text class="a" x="{}" y="{:.1f}" text-anchor="end">{}</text>
+)svg",
+                    PL - 8,
+                    y + ch * 0.5 + 4,
+                    fmt_count(g.ys[r]));
+    }
+    for(size_t c = 0; c < cols; ++c)
+        s += format(R"svg(<text class="a" x="{:.1f}" y="{}" text-anchor="middle">{}</text>
+)svg",
+                    PL + (double(c) + 0.5) * cw,
+                    PT + PH + 18,
+                    fmt_count(g.xs[c]));
+
+    // Legend: the color bar with the range of values.
+    const int lx = PL + PW + LEGEND_GAP;
+    for(int k = 0; k < 32; ++k)
+        s += format(R"svg(<rect x="{}" y="{:.1f}" width="{}" height="{:.1f}" fill="{}"/>
+)svg",
+                    lx,
+                    PT + PH - double(k + 1) * PH / 32.0,
+                    LEGEND_W,
+                    PH / 32.0 + 0.5,
+                    viridis((k + 0.5) / 32.0));
+    s += format(R"svg(<text class="a" x="{}" y="{}">{} {}</text>
+<text class="a" x="{}" y="{}">{} {}</text>
+<text class="a" x="{}" y="{}" text-anchor="end">{}</text>
+<text class="a" x="{}" y="{}" text-anchor="end">{}</text>
+)svg",
+                lx + LEGEND_W + 6,
+                PT + 10,
+                fmt_tick(hi),
+                esc(g.unit),
+                lx + LEGEND_W + 6,
+                PT + PH,
+                fmt_tick(lo),
+                esc(g.unit),
+                PL - 8,
+                PT - 10,
+                esc(g.y_label),
+                PL + PW,
+                PT + PH + 44,
+                esc(g.x_label));
+
+    s += "</svg>\n";
+    return s;
+}
+
+string md_grid(const grid & g, string_view caption) {
+    string s;
+    if(!caption.empty())
+        s += format("{}\n\n", caption);
+    s += format("_{} in {}, rows are {} and columns are {}_\n\n",
+                g.unit == "ms" ? "Time" : "Values",
+                g.unit,
+                g.y_label,
+                g.x_label);
+
+    s += format("| {} \\ {} |", g.y_label, g.x_label);
+    for(int x : g.xs)
+        s += format(" {} |", x);
+    s += "\n|---|";
+    for(size_t i = 0; i < g.xs.size(); ++i)
+        s += "---:|";
+    s += "\n";
+
+    for(size_t r = 0; r < g.ys.size(); ++r) {
+        s += format("| {} |", g.ys[r]);
+        for(size_t c = 0; c < g.xs.size(); ++c) {
+            const auto & v = g.values[r * g.xs.size() + c];
+            s += v ? format(" {:.3f} |", *v) : string{" N/A |"};
+        }
+        s += "\n";
+    }
+    return s;
+}
+
 } // namespace chart
@@ -1,24 +1,54 @@
 #pragma once
 
+#include <cstddef>
 #include <optional>
 #include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace chart {
 
 struct point {
     int                   x = 0;
     std::optional<double> y;
+    std::optional<double> lo; // spread around y, drawn as a shaded band
+    std::optional<double> hi;
 };
 
 struct series {
     std::string_view       label;
     std::string_view       color;
     std::span<const point> pts;
+    bool                   dashed = false; // e.g. a second series of the same language
 };
 
-std::string svg_lines(std::span<const series> ss, std::string_view title);
-std::string md_pivot(std::span<const series> ss, std::string_view caption = {}, std::string_view unit = "ms");
+struct options {
+    bool             log_y          = false;
+    std::size_t      max_points     = 0; // per series, LTTB-downsampled above that; 0 keeps all
+    std::string_view y_unit         = "ms";
+    std::string_view x_unit         = "functions";
+    bool             compile_header = false; // the standard "time to compile N functions" header instead of the title
+};
+
+// Values over a 2-D sweep, e.g. compile time over functions x statements per function.
+struct grid {
+    std::string_view                   x_label = "functions";
+    std::string_view                   unit    = "ms";
+    std::string_view                   y_label;
+    std::vector<int>                   xs;     // columns
+    std::vector<int>                   ys;     // rows
+    std::vector<std::optional<double>> values; // row-major: values[row * xs.size() + col]
+};
+
+std::string svg_lines(std::span<const series> ss, std::string_view title, const options & o = {});
+// Cells are colored on a log scale, so growth by the same factor looks the same everywhere in the grid.
+std::string svg_heatmap(const grid & g, std::string_view title);
+// `note` replaces the default "Time in <unit> (lower is better)" line under the caption.
+std::string md_pivot(std::span<const series> ss,
+                     std::string_view        caption = {},
+                     std::string_view        unit    = "ms",
+                     std::string_view        note    = {});
+std::string md_grid(const grid & g, std::string_view caption = {});
 
 } // namespace chart
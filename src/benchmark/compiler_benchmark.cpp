@@ -8,6 +8,7 @@
 #include <fstream>
 #include <vector>
 #include <charconv>
+#include <cctype>
 #include <cstring>
 #include <chrono>
 #include <optional>
@@ -15,18 +16,35 @@
 #include <ranges>
 #include <limits>
 #include <span>
+#include <future>
+#include <numeric>
+#include <functional>
+#include <random>
+#include <set>
+#include <map>
+#include <atomic>
+#include <latch>
+#include <system_error>
 
 #include "exec.hpp"
 #include "languages.hpp"
 #include "chart.hpp"
+#include "environment.hpp"
+#include "history.hpp"
+#include "stats.hpp"
+#include "timings.hpp"
+#include "tool_cache.hpp"
+#include "trace.hpp"
 
 using namespace std;
 
 using sv = string_view;
 
 struct tool_version_result {
-    unsigned long    exit_code = 1;
-    optional<string> version;
+    unsigned long              exit_code = 1;
+    optional<string>           version;
+    optional<filesystem::path> path;
+    bool                       cached = false;
 };
 
 static string md_escape_inline_code(string_view s) {
@@ -45,11 +63,16 @@ static string md_escape_inline_code(string_view s) {
 
 template <auto V>
 constexpr auto enum_to_string() {
+#ifdef _MSC_VER
     sv s{__FUNCSIG__};
     return s.substr(s.rfind('<') + 1, s.rfind('>') - s.rfind('<') - 1);
+#else
+    sv s{__PRETTY_FUNCTION__}; // "... [with auto V = Jai]"
+    return s.substr(s.rfind("= ") + 2, s.rfind(']') - s.rfind("= ") - 2);
+#endif
 }
 
-template <int... i>
+template <size_t... i>
 constexpr auto make_lang_names(index_sequence<i...>) {
     return array{enum_to_string<Lang(i)>()...};
 }
@@ -58,16 +81,24 @@ constexpr sv lang_name(Lang l) { return make_lang_names(make_index_sequence<Lang
 template <Lang L>
 struct Bench {
     using S = LangSpec<L>;
-    static inline string src(int num_fns) {
+
+    // `stmts` BodyStmt lines go into every function, for growing the code without adding symbols.
+    static inline string src(int num_fns, int stmts = 0) {
         static string s;
-        s.reserve(num_fns * 100);
+        s.reserve(num_fns * (100 + stmts * 24));
         s.clear();
 
         if constexpr(requires { S::Prolog; })
             s += S::Prolog;
 
+        string body;
         for(int i = 0; i < num_fns; ++i) {
-            s += vformat(sv{S::Function}, make_format_args(i, i));
+            body.clear();
+            for(int k = 0; k < stmts; ++k) {
+                const int v = i + k;
+                body += vformat(sv{S::BodyStmt}, make_format_args(k, v));
+            }
+            s += vformat(sv{S::Function}, make_format_args(i, i, body));
             s += '\n';
         }
 
@@ -84,155 +115,1332 @@ struct Bench {
 };
 
 template <Lang L>
-void gen_bench(auto filename, int num_fns) {
-    ofstream{filename} << Bench<L>::src(num_fns);
+void gen_bench(auto filename, int num_fns, int stmts = 0) {
+    trace::span _{"gen_bench", {{"lang", string{lang_name(L)}}, {"num_fns", to_string(num_fns)}}};
+    ofstream{filename} << Bench<L>::src(num_fns, stmts);
     println("{} generated.", filename);
 }
 
 using duration_t = chrono::duration<double, milli>;
 
 void clean() {
-    error_code _;
-    filesystem::remove("bench.exe", _);
-    filesystem::remove("bench.pdb", _);
-    filesystem::remove("bench.obj", _);
+    trace::span _{"clean"};
+    error_code  ec;
+    filesystem::remove("bench.exe", ec);
+    filesystem::remove("bench.pdb", ec);
+    filesystem::remove("bench.obj", ec);
+    filesystem::remove("bench", ec);
+    filesystem::remove("bench.o", ec);
+}
+
+using dir_listing = set<filesystem::path>;
+
+dir_listing list_work_dir() {
+    dir_listing names;
+    error_code  ec;
+    for(auto & e : filesystem::directory_iterator{".", ec})
+        names.insert(e.path().filename());
+    return names;
+}
+
+// Total size of whatever the last compile added to the work dir (executables, objects, pdbs, caches). All of it is
+// removed, so every sample starts from the same listing and counts the same artifacts.
+uintmax_t take_artifacts(const dir_listing & before) {
+    uintmax_t                bytes = 0;
+    vector<filesystem::path> added;
+    error_code               ec;
+    for(auto & e : filesystem::directory_iterator{".", ec}) {
+        if(before.contains(e.path().filename()))
+            continue;
+        if(e.is_regular_file(ec))
+            bytes += e.file_size(ec);
+        else if(e.is_directory(ec))
+            for(auto & f : filesystem::recursive_directory_iterator{e.path(), ec})
+                if(f.is_regular_file(ec))
+                    bytes += f.file_size(ec);
+        added.push_back(e.path());
+    }
+    for(auto & p : added)
+        filesystem::remove_all(p, ec);
+    return bytes;
+}
+
+using samples_t = vector<double>;
+
+// Per-sample results of one command; everything but the wall time is measured around the same exec().
+struct measurement {
+    samples_t ms;
+    samples_t artifact_bytes;
+    samples_t io_bytes; // read + written through any read/write call, pipes and terminals included
+    samples_t io_syscalls;
+};
+
+// Runs the commands round-robin, reversing the order every other round (ABBA...), so slow drift of the machine and
+// whatever one command leaves warm for the next affect all of them equally.
+// `before_sample` runs untimed before every sample. On failure, `oom` tells whether exec() ran out of memory.
+optional<vector<measurement>> measure_interleaved(sv                       label,
+                                                  span<const string>       cmds,
+                                                  size_t                   reps,
+                                                  const function<void()> & before_sample = {},
+                                                  out_of_memory *          oom           = nullptr) {
+    for(auto & cmd : cmds)
+        println("\nMeasuring: {}", cmd);
+    trace::span _{"measure", {{"lang", string{label}}, {"cmd", cmds.empty() ? string{} : cmds[0]}}};
+
+    vector<measurement> results(cmds.size(), {samples_t(reps), samples_t(reps), samples_t(reps), samples_t(reps)});
+    for(size_t i = 0; i < reps; ++i) {
+        for(size_t k = 0; k < cmds.size(); ++k) {
+            const size_t c = i % 2 ? cmds.size() - 1 - k : k;
+            trace::span  sample{"sample", {{"lang", string{label}}, {"rep", to_string(i)}, {"cmd", to_string(c)}}};
+            if(before_sample)
+                before_sample();
+            clean(); // leftovers of an earlier run would otherwise count from the second sample on
+            const auto  before = list_work_dir();
+            exec_result r;
+            duration_t  time_ms;
+            {
+                // Opened before and closed after the timed window, so the tracer's own work stays out of it.
+                trace::span _{"exec"};
+                const auto  start = chrono::high_resolution_clock::now();
+                r                 = exec(cmds[c], false);
+                time_ms           = chrono::high_resolution_clock::now() - start;
+            }
+
+            if(r.exit_code != 0) {
+                println("{}",
+                        r.oom == out_of_memory::killed     ? "...out of memory."
+                        : r.oom == out_of_memory::possibly ? "...failed, possibly out of memory."
+                                                           : "...failed.");
+                if(oom)
+                    *oom = r.oom;
+                take_artifacts(before);
+                return {};
+            }
+
+            auto & m            = results[c];
+            m.artifact_bytes[i] = double(take_artifacts(before));
+
+            m.ms[i]          = time_ms.count();
+            m.io_bytes[i]    = double(r.io.read_bytes + r.io.write_bytes);
+            m.io_syscalls[i] = double(r.io.syscalls);
+            trace::counter("compile_ms", {{label, m.ms[i]}});
+            trace::counter("io_mb", {{label, m.io_bytes[i] / 1e6}});
+        }
+    }
+
+    return results;
+}
+
+constexpr size_t SAMPLES = 5; // per variant and size
+
+optional<measurement> measure(sv                       label,
+                              const string &           cmd,
+                              size_t                   reps          = SAMPLES,
+                              const function<void()> & before_sample = {},
+                              out_of_memory *          oom           = nullptr) {
+    auto results = measure_interleaved(label, span{&cmd, 1}, reps, before_sample, oom);
+    return results ? optional{std::move(results->front())} : nullopt;
+}
+
+// One measured configuration: a language, plus the linker for toolchains that sweep over linkers.
+struct variant {
+    Lang                     lang;
+    string                   label;
+    sv                       color;
+    sv                       ext;
+    sv                       cmd;
+    sv                       linker;
+    bool                     compile_only = false;
+    sv                       comment;   // LangSpec::Comment, for salting the source
+    span<const char * const> cache_env;          // LangSpec::CacheEnv
+    unsigned                 max_body_stmts = 0; // LangSpec::MaxBodyStmts; 0: no limit
+};
+
+template <size_t... i>
+vector<variant> make_variants(index_sequence<i...>) {
+    vector<variant> vs;
+
+    auto add = [&]<Lang L>() {
+        using S = LangSpec<L>;
+
+        const size_t first = vs.size();
+        if constexpr(requires { S::Linkers; }) {
+            for(size_t k = 0; k < size(S::Linkers); ++k) {
+                const auto label = format("{}+{}", lang_name(L), S::Linkers[k]);
+                vs.push_back({L, label, linker_color(L, k), S::Ext, S::Cmd, S::Linkers[k]});
+            }
+            vs.push_back({L, format("{} (compile only)", lang_name(L)), gh_color(L), S::Ext, S::CompileCmd, {}, true});
+        } else
+            vs.push_back({L, string{lang_name(L)}, gh_color(L), S::Ext, S::Cmd, {}});
+
+        for(auto & v : span{vs}.subspan(first)) {
+            v.comment = S::Comment;
+            if constexpr(requires { S::CacheEnv; })
+                v.cache_env = S::CacheEnv;
+            if constexpr(requires { S::MaxBodyStmts; })
+                v.max_body_stmts = S::MaxBodyStmts;
+        }
+    };
+    (add.template operator()<Lang(i)>(), ...);
+    return vs;
+}
+
+// as_is leaves the toolchains' caches alone, so samples may mix cold and cached compiles.
+// cold salts the source and hands the caches an empty directory before every sample; warm primes them first.
+enum class cache_mode { as_is, cold, warm, both };
+
+constexpr sv cache_suffix(cache_mode m) {
+    return m == cache_mode::cold ? " (cold)" : m == cache_mode::warm ? " (warm)" : "";
+}
+
+// Points the variant's toolchain caches (LangSpec::CacheEnv) at `dir` in the work dir, for as long as `env` lives.
+void point_caches_at(const variant & v, const filesystem::path & dir, scoped_env & env) {
+    filesystem::create_directories(dir);
+    for(const char * name : v.cache_env)
+        env.set(name, filesystem::absolute(dir).string());
+}
+
+// Warm caches get a directory per (variant, size), so a cache hit is always on the source being measured.
+filesystem::path warm_cache_dir(const variant & v, int num_fns) {
+    return filesystem::path{"cache_warm"} / format("{}_{}", v.label, num_fns);
+}
+
+// The untimed compile that primes the caches the variant points at; whatever else it leaves in the work dir is removed.
+void warm_up(const variant & v, const string & cmd, int num_fns) {
+    trace::span _{"warm_up", {{"lang", v.label}, {"num_fns", to_string(num_fns)}}};
+    const auto  before = list_work_dir();
+    exec(cmd, false);
+    take_artifacts(before);
+}
+
+optional<measurement>
+measure_cached(const variant & v, const string & cmd, cache_mode mode, int num_fns, size_t reps = SAMPLES) {
+    scoped_env env;
+    if(mode == cache_mode::warm) {
+        point_caches_at(v, warm_cache_dir(v, num_fns), env);
+        warm_up(v, cmd, num_fns);
+        return measure(v.label, cmd, reps);
+    }
+    if(mode == cache_mode::cold) {
+        static mt19937_64 salt{random_device{}()};
+        const auto        filename = format("bench{}", v.ext);
+        return measure(v.label, cmd, reps, [&] {
+            const auto line = format("salt {:016x}", salt());
+            ofstream{filename, ios::app} << '\n' << vformat(v.comment, make_format_args(line)) << '\n';
+            error_code ec;
+            filesystem::remove_all("cache_cold", ec);
+            point_caches_at(v, "cache_cold", env);
+        });
+    }
+    return measure(v.label, cmd, reps);
+}
+
+template <size_t... i>
+auto bench_once(int num_fns, span<const variant> variants, cache_mode mode, index_sequence<i...>) {
+    trace::span _{"bench_once", {{"num_fns", to_string(num_fns)}, {"cache", string{cache_suffix(mode)}}}};
+    (gen_bench<Lang(i)>(format("bench{}", LangSpec<Lang(i)>::Ext), num_fns), ...);
+
+    vector<optional<measurement>> samples;
+    for(auto & v : variants) {
+        const auto filename = format("bench{}", v.ext);
+        samples.push_back(measure_cached(v, vformat(v.cmd, make_format_args(filename, v.linker)), mode, num_fns));
+    }
+
+    vector<size_t> order(variants.size());
+    iota(begin(order), end(order), size_t{0});
+    ranges::stable_sort(order, {}, [&](size_t v) {
+        return samples[v] ? stats::median(samples[v]->ms) : numeric_limits<double>::infinity();
+    });
+    for(size_t v : order)
+        if(samples[v])
+            println("{}: {}ms", variants[v].label, stats::median(samples[v]->ms));
+        else
+            println("{}: N/A", variants[v].label);
+
+    return samples;
 }
 
-optional<duration_t> measure(auto cmd) {
-    println("\nMeasuring: {}", cmd);
-    array<duration_t, 5> times{};
-    for(size_t i = 0; i < size(times); ++i) {
-        const auto       start     = chrono::high_resolution_clock::now();
-        const int        exit_code = exec(cmd, false).exit_code;
-        const duration_t time_ms   = chrono::high_resolution_clock::now() - start;
+// What every sample pays regardless of the source: spawning and waiting for a process, and the toolchain's startup.
+struct calibration {
+    double                   harness_ms = 0.0; // exec() of the harness itself with --noop
+    vector<optional<double>> floor_ms;         // per variant, compiling a source with no functions
+};
+
+template <size_t... i>
+calibration calibrate(span<const variant> variants, cache_mode mode, index_sequence<i...> langs) {
+    constexpr size_t CALIBRATION_REPS = 20;
+
+    trace::span  _{"calibrate"};
+    calibration  c;
+    const string noop = format("\"{}\" --noop", current_executable().string());
+    if(const auto m = measure_interleaved("harness", span{&noop, 1}, CALIBRATION_REPS))
+        c.harness_ms = stats::median(m->front().ms);
+    println("Harness overhead: {:.3f}ms", c.harness_ms);
+
+    for(auto & s : bench_once(0, variants, mode, langs))
+        c.floor_ms.push_back(s ? optional{stats::median(s->ms)} : nullopt);
+    return c;
+}
+
+string calibration_md(const calibration & c, span<const variant> variants) {
+    string md = "### Calibration\n\n";
+    md += format("_Spawning a process that exits right away through the same exec() takes {:.3f} ms. The floor is a "
+                 "compile of a source with no functions_\n\n",
+                 c.harness_ms);
+    md += "| Language | Floor ms | Floor - harness ms |\n";
+    md += "|---|---:|---:|\n";
+    for(size_t v = 0; v < variants.size(); ++v)
+        if(c.floor_ms[v])
+            md += format("| {} | {:.3f} | {:.3f} |\n", variants[v].label, *c.floor_ms[v], *c.floor_ms[v] - c.harness_ms);
+        else
+            md += format("| {} | N/A | N/A |\n", variants[v].label);
+    return md;
+}
+
+template <size_t... i>
+void gen_source(Lang l, int num_fns, index_sequence<i...>) {
+    ((l == Lang(i) ? gen_bench<Lang(i)>(format("bench{}", LangSpec<Lang(i)>::Ext), num_fns) : void()), ...);
+}
+
+using results_by_size = map<int, vector<optional<measurement>>>;
+
+// Runs every (variant, size, repetition) as a job of its own in a seeded random order, so slow drift of the machine
+// spreads over all languages instead of biasing whichever ran at the time. Every job is logged to `jobs_path`.
+template <size_t... i>
+results_by_size bench_shuffled(span<const int>         sizes,
+                               span<const variant>     variants,
+                               cache_mode              mode,
+                               uint64_t                seed,
+                               const filesystem::path & jobs_path,
+                               sv                      run,
+                               index_sequence<i...>    langs) {
+    struct job {
+        size_t v;
+        int    num_fns;
+        size_t rep;
+    };
+    vector<job> jobs;
+    for(int num_fns : sizes)
+        for(size_t v = 0; v < variants.size(); ++v)
+            for(size_t rep = 0; rep < SAMPLES; ++rep)
+                jobs.push_back({v, num_fns, rep});
+    ranges::shuffle(jobs, mt19937_64{seed});
+
+    results_by_size results;
+    for(int num_fns : sizes)
+        results[num_fns].assign(variants.size(), measurement{});
 
-        if(exit_code != 0) {
+    // Warm caches are primed once per (variant, size) instead of before every job.
+    if(mode == cache_mode::warm)
+        for(int num_fns : sizes) {
+            println("\nPriming caches with {} functions:", num_fns);
+            (gen_bench<Lang(i)>(format("bench{}", LangSpec<Lang(i)>::Ext), num_fns), ...);
+            for(auto & var : variants) {
+                scoped_env env;
+                point_caches_at(var, warm_cache_dir(var, num_fns), env);
+                const auto filename = format("bench{}", var.ext);
+                warm_up(var, vformat(var.cmd, make_format_args(filename, var.linker)), num_fns);
+            }
+        }
+
+    ofstream tsv{jobs_path};
+    tsv << format("# run {} seed {}\n", run, seed);
+    tsv << "order\tlang\tnum_fns\trep\tms\tartifact_bytes\tio_bytes\tio_syscalls\n";
+
+    // Sources are only regenerated when the next job needs another one. Keyed by file, since languages share them
+    // (Gcc, Clang and Tcc all write bench.c).
+    map<sv, pair<Lang, int>> generated;
+    for(size_t order = 0; order < jobs.size(); ++order) {
+        const auto & [v, num_fns, rep] = jobs[order];
+        const auto & var               = variants[v];
+        auto &       slot              = results[num_fns][v];
+        if(!slot)
+            continue; // an earlier repetition failed
+        trace::span _{"job", {{"order", to_string(order)}, {"lang", var.label}, {"num_fns", to_string(num_fns)}}};
+
+        if(const auto it = generated.find(var.ext); it == end(generated) || it->second != pair{var.lang, num_fns}) {
+            gen_source(var.lang, num_fns, langs);
+            generated[var.ext] = {var.lang, num_fns};
+        }
+        const auto            filename = format("bench{}", var.ext);
+        const auto            cmd      = vformat(var.cmd, make_format_args(filename, var.linker));
+        optional<measurement> m;
+        if(mode == cache_mode::warm) {
+            scoped_env env;
+            point_caches_at(var, warm_cache_dir(var, num_fns), env);
+            m = measure(var.label, cmd, 1);
+        } else
+            m = measure_cached(var, cmd, mode, num_fns, 1);
+        if(!m) {
+            slot = nullopt;
+            tsv << format("{}\t{}\t{}\t{}\tfailed\t\t\t\n", order, var.label, num_fns, rep);
+            continue;
+        }
+        slot->ms.push_back(m->ms[0]);
+        slot->artifact_bytes.push_back(m->artifact_bytes[0]);
+        slot->io_bytes.push_back(m->io_bytes[0]);
+        slot->io_syscalls.push_back(m->io_syscalls[0]);
+        tsv << format("{}\t{}\t{}\t{}\t{:.3f}\t{}\t{}\t{}\n",
+                      order,
+                      var.label,
+                      num_fns,
+                      rep,
+                      m->ms[0],
+                      m->artifact_bytes[0],
+                      m->io_bytes[0],
+                      m->io_syscalls[0]);
+    }
+    return results;
+}
+
+// An A/B command is either a full command template (with {}) or another binary for the variant's own command.
+static string ab_command(const variant & v, sv alt) {
+    if(alt.find('{') != sv::npos)
+        return string{alt};
+    string exe;
+    for(char c : alt)
+        exe += c == '}' ? "}}" : string(1, c); // a binary's path isn't a template
+    const auto rest = v.cmd.substr(min(v.cmd.find(' '), v.cmd.size()));
+    return (alt.find(' ') != sv::npos ? format("\"{}\"", exe) : exe) + string{rest};
+}
+
+// A full --ab command is a template with {0} for the source and {1} for the linker; a bad one would otherwise throw
+// in the middle of the run.
+static bool valid_ab_template(sv alt) {
+    if(alt.find('{') == sv::npos)
+        return true;
+    try {
+        [[maybe_unused]] const auto _ = vformat(alt, make_format_args("bench.src", "linker"));
+        return true;
+    } catch(const format_error & e) {
+        println("Invalid --ab command {}: {}. Use {{}} or {{0}} for the source file, {{1}} for the linker and "
+                "{{{{ }}}} for literal braces.",
+                alt,
+                e.what());
+        return false;
+    }
+}
+
+// Compares two installs of the same toolchain with interleaved samples, as a paired speedup per size.
+template <size_t... i>
+string ab_compare(const variant & v, const array<string, 2> & alts, span<const int> sizes, index_sequence<i...> langs) {
+    constexpr size_t AB_PAIRS = 10;
+
+    const array templates = {ab_command(v, alts[0]), ab_command(v, alts[1])};
+    string      md        = format("### A/B: {}\n\n- A: `{}`\n- B: `{}`\n\n", v.label, templates[0], templates[1]);
+    md += format("_Speedup is A time / B time (above 1 means B is faster): geometric mean over {} pairs, interleaved "
+                 "ABBA, with its 95% CI_\n\n",
+                 AB_PAIRS);
+    md += "| Functions | A ms | B ms | Speedup | 95% CI |\n";
+    md += "|---:|---:|---:|---:|---|\n";
+
+    for(int num_fns : sizes) {
+        gen_source(v.lang, num_fns, langs);
+        const auto  filename = format("bench{}", v.ext);
+        const array cmds     = {vformat(templates[0], make_format_args(filename, v.linker)),
+                                vformat(templates[1], make_format_args(filename, v.linker))};
+        const auto  times    = measure_interleaved(v.label, cmds, AB_PAIRS);
+        if(!times) {
+            md += format("| {} | N/A | N/A | N/A | |\n", num_fns);
+            continue;
+        }
+
+        const auto   r = stats::paired_ratio((*times)[0].ms, (*times)[1].ms);
+        const double a = stats::median((*times)[0].ms), b = stats::median((*times)[1].ms);
+        println("{} @ {} functions: A {:.3f}ms, B {:.3f}ms, speedup {:.3f} [{:.3f}, {:.3f}]",
+                v.label,
+                num_fns,
+                a,
+                b,
+                r.estimate,
+                r.ci.lo,
+                r.ci.hi);
+        md += format(
+          "| {} | {:.3f} | {:.3f} | {:.3f} | [{:.3f}, {:.3f}] |\n", num_fns, a, b, r.estimate, r.ci.lo, r.ci.hi);
+    }
+    return md;
+}
+
+constexpr int STRESS_NUM_FNS = 1000; // unless a size is given on the command line
+
+// Runs N copies of the same compile at once, each in its own directory, for N from 1 to twice the CPU count.
+template <size_t... i>
+string stress(const variant & v, int num_fns, unsigned cpus, index_sequence<i...> langs) {
+    constexpr size_t STRESS_ROUNDS = 3; // back-to-back compiles per copy
+
+    vector<unsigned> ns;
+    for(unsigned n = 1; n < cpus; n *= 2)
+        ns.push_back(n);
+    ns.push_back(cpus);
+    ns.push_back(cpus * 2);
+
+    gen_source(v.lang, num_fns, langs);
+    const auto filename = format("bench{}", v.ext);
+    const auto cmd      = vformat(v.cmd, make_format_args(filename, v.linker));
+
+    string md =
+      format("### Concurrent compiles: {} @ {} functions\n\n- `{}`\n- {} CPUs\n\n", v.label, num_fns, cmd, cpus);
+    md += format("_N copies compile at once, {} times each. Latency is per compile; efficiency is throughput over N "
+                 "times the throughput of N = 1_\n\n",
+                 STRESS_ROUNDS);
+    md += "| N | Builds/s | p50 ms | p90 ms | p99 ms | Max ms | Efficiency |\n";
+    md += "|---:|---:|---:|---:|---:|---:|---:|\n";
+
+    double single = 0.0;
+    for(unsigned n : ns) {
+        trace::span _{"stress", {{"lang", string{v.label}}, {"n", to_string(n)}}};
+        println("\n{} x{}: {}", v.label, n, cmd);
+
+        vector<filesystem::path> dirs;
+        for(unsigned w = 0; w < n; ++w) {
+            const auto & dir = dirs.emplace_back(format("stress{}", w));
+            filesystem::create_directories(dir);
+            filesystem::copy_file(filename, dir / filename, filesystem::copy_options::overwrite_existing);
+        }
+
+        vector<samples_t>    latencies(n);
+        atomic<bool>         failed = false;
+        latch                go{ptrdiff_t(n) + 1};
+        vector<future<void>> copies;
+        copies.reserve(n); // push_back mustn't throw with a started copy in hand
+        try {
+            for(unsigned w = 0; w < n; ++w)
+                copies.push_back(async(launch::async, [&, w] {
+                    go.arrive_and_wait();
+                    for(size_t r = 0; r < STRESS_ROUNDS && !failed; ++r) {
+                        const auto       start     = chrono::high_resolution_clock::now();
+                        const auto       exit_code = exec(cmd, false, dirs[w]).exit_code;
+                        const duration_t time_ms   = chrono::high_resolution_clock::now() - start;
+                        if(exit_code != 0)
+                            failed = true;
+                        latencies[w].push_back(time_ms.count());
+                    }
+                }));
+        } catch(const system_error & e) {
+            // Out of threads: arrive for the copies that never started, so the started ones aren't stuck at `go`.
+            println("Couldn't start copy {} of {}: {}", copies.size() + 1, n, e.what());
+            failed = true;
+            go.count_down(ptrdiff_t(n - copies.size()));
+        }
+        const auto start = chrono::high_resolution_clock::now();
+        go.arrive_and_wait();
+        for(auto & c : copies)
+            c.get();
+        const duration_t wall_ms = chrono::high_resolution_clock::now() - start;
+
+        error_code ec;
+        for(auto & dir : dirs)
+            filesystem::remove_all(dir, ec);
+
+        if(failed) {
             println("...failed.");
-            return {};
+            md += format("| {} | N/A | | | | | |\n", n);
+            continue;
         }
 
-        clean();
+        samples_t all;
+        for(auto & l : latencies)
+            all.insert(end(all), begin(l), end(l));
+        const double builds_per_s = double(all.size()) * 1e3 / wall_ms.count();
+        if(n == 1)
+            single = builds_per_s;
+        const double efficiency = single > 0.0 ? builds_per_s / (single * n) : 0.0;
+        const double p50 = stats::percentile(all, 0.5), p90 = stats::percentile(all, 0.9),
+                     p99 = stats::percentile(all, 0.99), max_ms = ranges::max(all);
+        println("{:.2f} builds/s, p50 {:.0f}ms, p99 {:.0f}ms, efficiency {:.2f}", builds_per_s, p50, p99, efficiency);
+        trace::counter("builds_per_s", {{v.label, builds_per_s}});
+        md += format("| {} | {:.2f} | {:.0f} | {:.0f} | {:.0f} | {:.0f} | {:.2f} |\n",
+                     n,
+                     builds_per_s,
+                     p50,
+                     p90,
+                     p99,
+                     max_ms,
+                     efficiency);
+    }
+    return md;
+}
+
+// Compile time vs the number of CPUs under an optional memory limit, the shape of a CI runner.
+template <size_t... i>
+string limits_sweep(span<const variant>   variants,
+                    span<const int>       sizes,
+                    span<const unsigned>  cpu_counts,
+                    unsigned long long    memory_bytes,
+                    const chart::options & chart_opts,
+                    index_sequence<i...>) {
+    // pts[size][variant] has a point per CPU count.
+    vector<vector<vector<chart::point>>> pts(sizes.size(), vector<vector<chart::point>>(variants.size()));
+    string                               how, failures;
+    set<unsigned>                        done; // CPU counts actually applied
+    const auto memory = memory_bytes ? format("{:.1f} GiB", double(memory_bytes) / double(1ull << 30)) : "unlimited";
 
-        times[i] = time_ms;
+    for(unsigned requested : cpu_counts) {
+        const auto applied = set_limits({.cpus = requested, .memory_bytes = memory_bytes});
+        const auto cpus    = applied.cpus;
+        how                = applied.how;
+        if(cpus != requested)
+            println("\nOnly {} of the {} requested CPUs are usable.", cpus, requested);
+        if(!done.insert(cpus).second)
+            continue;
+        println("\nLimits: {} CPUs, {} memory ({})", cpus, memory, how);
+        trace::span _{"limits", {{"cpus", to_string(cpus)}, {"memory", memory}}};
+
+        for(size_t k = 0; k < sizes.size(); ++k) {
+            (gen_bench<Lang(i)>(format("bench{}", LangSpec<Lang(i)>::Ext), sizes[k]), ...);
+            for(size_t v = 0; v < variants.size(); ++v) {
+                const auto filename = format("bench{}", variants[v].ext);
+                const auto cmd      = vformat(variants[v].cmd, make_format_args(filename, variants[v].linker));
+                auto       oom      = out_of_memory::no;
+                const auto m        = measure(variants[v].label, cmd, SAMPLES, {}, &oom);
+                pts[k][v].push_back({int(cpus), m ? optional{stats::median(m->ms)} : nullopt});
+                if(!m)
+                    failures += format("| {} | {} | {} | {} |\n",
+                                       variants[v].label,
+                                       cpus,
+                                       sizes[k],
+                                       oom == out_of_memory::killed     ? "out of memory"
+                                       : oom == out_of_memory::possibly ? "possibly out of memory"
+                                                                        : "failed");
+            }
+        }
     }
+    set_limits({});
+
+    vector<vector<chart::series>> series(sizes.size());
+    for(size_t k = 0; k < sizes.size(); ++k)
+        for(size_t v = 0; v < variants.size(); ++v)
+            series[k].push_back({variants[v].label, variants[v].color, pts[k][v]});
 
-    ranges::sort(times);
-    return {times[times.size() / 2]}; // median
+    auto cores_opts   = chart_opts;
+    cores_opts.x_unit = "CPUs";
+    ofstream{"results_cores.svg"} << chart::svg_lines(
+      series.back(), format("compile time vs CPUs, {} functions", sizes.back()), cores_opts);
+
+    string md =
+      format("### Resource limits\n\n- Memory: {}\n- Enforced with: {}\n\n![](results_cores.svg)", memory, how);
+    for(size_t k = 0; k < sizes.size(); ++k)
+        md += "\n\n" + chart::md_pivot(series[k],
+                                        format("### Time vs CPUs @ {} functions", sizes[k]),
+                                        "ms",
+                                        "Time in ms (lower is better), one column per number of CPUs");
+    if(!failures.empty())
+        md += "\n\n### Failures under the limits\n\n_\"out of memory\" is reported by the cgroup's OOM killer; "
+              "\"possibly out of memory\" is a heuristic: peak job memory within 10% of the limit on Windows, "
+              "a SIGKILL/SIGSEGV/SIGABRT or an allocation failure on stderr under RLIMIT_AS_\n\n"
+              "| Language | CPUs | Functions | Reason |\n|---|---:|---:|---|\n" +
+              failures;
+    return md;
 }
 
-template <int... i>
-auto bench_once(int num_fns, index_sequence<i...>) {
-    const array filenames = {format("bench{}", LangSpec<Lang(i)>::Ext)...};
-    (gen_bench<Lang(i)>(filenames[i], num_fns), ...);
-    const array cmds = {vformat(sv{LangSpec<Lang(i)>::Cmd}, make_format_args(filenames[i]))...};
-    const array raw  = {make_tuple(Lang(i), measure(cmds[i]))...};
+constexpr array GRID_NUM_FNS = {1000, 2000, 4000, 8000, 16000}; // unless a size is given on the command line
 
-    auto times = raw;
-    ranges::stable_sort(times, {}, [](const auto & x) {
-        const auto & t = get<1>(x);
-        return t ? t->count() : numeric_limits<double>::infinity();
-    });
-    for(const auto & [lang, time] : times)
-        if(time)
-            println("{}: {}", lang_name(lang), *time);
+// Compile time over functions x statements per function, to tell scaling with symbol count from scaling with code
+// volume.
+template <size_t... i>
+string sweep_2d(span<const variant> variants, span<const int> sizes, span<const unsigned> stmts, index_sequence<i...>) {
+    vector<chart::grid> grids(variants.size());
+    for(auto & g : grids) {
+        g.y_label = "statements per function";
+        g.xs.assign(begin(sizes), end(sizes));
+        g.ys.assign(begin(stmts), end(stmts));
+        g.values.resize(sizes.size() * stmts.size());
+    }
+
+    for(size_t r = 0; r < stmts.size(); ++r)
+        for(size_t c = 0; c < sizes.size(); ++c) {
+            println("\nGenerating bench sources with {} functions of {} statements:", sizes[c], stmts[r]);
+            trace::span _{"grid_cell", {{"num_fns", to_string(sizes[c])}, {"stmts", to_string(stmts[r])}}};
+            (gen_bench<Lang(i)>(format("bench{}", LangSpec<Lang(i)>::Ext), sizes[c], int(stmts[r])), ...);
+            for(size_t v = 0; v < variants.size(); ++v) {
+                if(variants[v].max_body_stmts && stmts[r] > variants[v].max_body_stmts)
+                    continue; // wouldn't compile; left empty and noted below
+                const auto filename = format("bench{}", variants[v].ext);
+                const auto cmd      = vformat(variants[v].cmd, make_format_args(filename, variants[v].linker));
+                const auto m        = measure(variants[v].label, cmd);
+                grids[v].values[r * sizes.size() + c] = m ? optional{stats::median(m->ms)} : nullopt;
+            }
+        }
+
+    string skipped;
+    for(auto & v : variants)
+        if(v.max_body_stmts && ranges::max(stmts) > v.max_body_stmts)
+            skipped += format("- {}: above {} statements per function, its limit\n", v.label, v.max_body_stmts);
+    string md = skipped.empty() ? "" : format("### Skipped cells\n\n{}\n", skipped);
+
+    md += "### Scaling fit\n\n_Least-squares fit of time = fixed + a * functions + b * statements, where "
+                "statements = functions * statements per function_\n\n";
+    md += "| Language | Fixed ms | ms per 1000 functions | ms per 1000 statements |\n";
+    md += "|---|---:|---:|---:|\n";
+    for(size_t v = 0; v < variants.size(); ++v) {
+        samples_t fns, total_stmts, ms;
+        for(size_t r = 0; r < stmts.size(); ++r)
+            for(size_t c = 0; c < sizes.size(); ++c)
+                if(const auto & y = grids[v].values[r * sizes.size() + c]) {
+                    fns.push_back(sizes[c]);
+                    total_stmts.push_back(double(sizes[c]) * stmts[r]);
+                    ms.push_back(*y);
+                }
+        if(const auto p = stats::fit_plane(fns, total_stmts, ms))
+            md += format("| {} | {:.3f} | {:.3f} | {:.3f} |\n", variants[v].label, p->c0, p->c1 * 1e3, p->c2 * 1e3);
         else
-            println("{}: N/A", lang_name(lang));
+            md += format("| {} | N/A | N/A | N/A |\n", variants[v].label);
+    }
 
-    return array<optional<double>, size_t(Lang::Count)>{
-      (get<1>(raw[i]) ? optional<double>{get<1>(raw[i])->count()} : nullopt)...};
+    for(size_t v = 0; v < variants.size(); ++v) {
+        string slug = variants[v].label;
+        ranges::replace_if(slug, [](char ch) { return !isalnum(static_cast<unsigned char>(ch)); }, '_');
+        const auto svg = format("results_2d_{}.svg", slug);
+        ofstream{svg} << chart::svg_heatmap(grids[v], format("{} compile time", variants[v].label));
+        md += format("\n\n![]({})\n\n{}", svg, chart::md_grid(grids[v], format("### {}", variants[v].label)));
+    }
+    return md;
+}
+
+template <Lang L>
+constexpr bool has_precompiled = requires { LangSpec<L>::PrecompileCmd; };
+
+struct load_points {
+    vector<chart::point> source, precompiled, precompile;
+};
+
+// Times the precompile step, then loading the program from source and from the precompiled artifact side by side.
+template <Lang L>
+void precompiled_times(int num_fns, load_points & pts) {
+    using S = LangSpec<L>;
+    if constexpr(has_precompiled<L>) {
+        const auto  filename = format("bench{}", S::Ext);
+        const auto  compile  = vformat(sv{S::PrecompileCmd}, make_format_args(filename, S::Precompiled));
+        trace::span _{"precompile", {{"lang", string{lang_name(L)}}, {"num_fns", to_string(num_fns)}}};
+        gen_bench<L>(filename, num_fns);
+
+        // The toolchain's caches (deno's DENO_DIR) start out empty for every load, so "source" means parsing from
+        // source. Precompiling keeps a cache of its own, since deno compile fetches its runtime into it.
+        scoped_env env;
+        auto       point_caches = [&](const filesystem::path & dir, bool fresh) {
+            if constexpr(requires { S::CacheEnv; }) {
+                error_code ec;
+                if(fresh)
+                    filesystem::remove_all(dir, ec);
+                filesystem::create_directories(dir);
+                for(const char * name : S::CacheEnv)
+                    env.set(name, filesystem::absolute(dir).string());
+            }
+        };
+        auto fail = [&] {
+            pts.source.push_back({num_fns, nullopt});
+            pts.precompiled.push_back({num_fns, nullopt});
+            pts.precompile.push_back({num_fns, nullopt});
+        };
+
+        // An untimed run first, for the runtime download. measure() removes every sample's artifact, so the one the
+        // loads use comes from a last untimed run.
+        point_caches("cache_precompile", false);
+        error_code ec;
+        exec(compile, false);
+        filesystem::remove(S::Precompiled, ec);
+        const auto c = measure(format("{} (precompile)", lang_name(L)), compile);
+        const auto r = c ? exec(compile, false) : exec_result{};
+        if(r.exit_code != 0 || !filesystem::exists(S::Precompiled)) {
+            println("{}: precompile failed - returned {}", lang_name(L), r.exit_code);
+            return fail();
+        }
+        pts.precompile.push_back({num_fns, stats::median(c->ms)});
+
+        // Interleaved, so drift over the run hits both forms alike.
+        const array cmds = {vformat(sv{S::Cmd}, make_format_args(filename)),
+                            vformat(sv{S::PrecompiledCmd}, make_format_args(S::Precompiled))};
+        const auto  m    = measure_interleaved(lang_name(L), cmds, SAMPLES, [&] { point_caches("cache_load", true); });
+        pts.source.push_back({num_fns, m ? optional{stats::median((*m)[0].ms)} : nullopt});
+        pts.precompiled.push_back({num_fns, m ? optional{stats::median((*m)[1].ms)} : nullopt});
+        filesystem::remove(S::Precompiled, ec);
+    }
+}
+
+// Load time from source vs from what production actually ships (bytecode, .pyc, a compiled binary).
+template <size_t... i>
+string precompiled_sweep(span<const int> sizes, const chart::options & chart_opts, index_sequence<i...>) {
+    array<load_points, size_t(Lang::Count)> pts;
+    for(int num_fns : sizes) {
+        println("\nPrecompiling bench sources with {} functions:", num_fns);
+        (precompiled_times<Lang(i)>(num_fns, pts[i]), ...);
+    }
+
+    vector<chart::series> load, precompile;
+    vector<string>        labels; // series only view their labels
+    labels.reserve(2 * size_t(Lang::Count));
+    auto add = [&](Lang l) {
+        if(pts[l].source.empty())
+            return;
+        const auto name = lang_name(l);
+        load.push_back({labels.emplace_back(format("{} (source)", name)), gh_color(l), pts[l].source});
+        load.push_back({labels.emplace_back(format("{} (precompiled)", name)), gh_color(l), pts[l].precompiled, true});
+        precompile.push_back({name, gh_color(l), pts[l].precompile});
+    };
+    (add(Lang(i)), ...);
+
+    ofstream{"results_precompiled.svg"} << chart::svg_lines(
+      load, "load and run time, source vs precompiled", chart_opts);
+    return format("### Precompiled load\n\n![](results_precompiled.svg)\n\n{}\n\n{}",
+                  chart::md_pivot(load, "### Load and run time"),
+                  chart::md_pivot(precompile,
+                                  "### Precompile time",
+                                  "ms",
+                                  format("Time in ms of the precompile step (median of {}, like the load times), "
+                                         "which production pays once per build, not per load",
+                                         SAMPLES)));
+}
+
+template <Lang L>
+constexpr bool has_timings = requires { LangSpec<L>::TimingCmd; };
+
+// One extra compile with the compiler's own timing report enabled, over the source bench_once() left behind.
+template <Lang L>
+optional<timings::phases> phase_times(int num_fns) {
+    using S = LangSpec<L>;
+    if constexpr(has_timings<L>) {
+        const auto  filename = format("bench{}", S::Ext);
+        const auto  cmd      = vformat(sv{S::TimingCmd}, make_format_args(filename));
+        trace::span _{"phase_times", {{"lang", string{lang_name(L)}}, {"num_fns", to_string(num_fns)}}};
+        const auto  r = exec(cmd);
+        clean();
+        if(r.exit_code != 0) {
+            println("{}: phase timings failed - returned {}", lang_name(L), r.exit_code);
+            return nullopt;
+        }
+        return S::Timings(r.std_out);
+    } else
+        return nullopt;
 }
 
 template <Lang l>
-tool_version_result tool_version() {
-    if(const auto [exit_code, std_out] = exec(LangSpec<l>::VersionCmd); exit_code == 0) {
-        auto non_empty = std_out | views::split('\n') | views::filter([](auto line) { return !line.empty(); });
+tool_version_result tool_version(const tool_cache::table & cache) {
+    trace::span _{"tool_version", {{"lang", string{lang_name(l)}}}};
+    const sv    cmd  = LangSpec<l>::VersionCmd;
+    const auto  path = which(cmd.substr(0, cmd.find(' ')));
+    const auto  key  = path ? tool_cache::key_of(*path) : nullopt;
+    if(key)
+        if(const auto it = cache.find(*key); it != end(cache))
+            return tool_version_result{.exit_code = 0, .version = it->second, .path = path, .cached = true};
+
+    if(const auto r = exec(cmd); r.exit_code == 0) {
+        auto non_empty = r.std_out | views::split('\n') | views::filter([](auto line) { return !line.empty(); });
         if(begin(non_empty) == end(non_empty))
-            return tool_version_result{.exit_code = 0, .version = nullopt};
+            return tool_version_result{.exit_code = 0, .version = nullopt, .path = path};
 
         const auto   fst_line = *begin(non_empty);
         const string version{begin(fst_line), end(fst_line)};
-        return tool_version_result{.exit_code = 0, .version = version};
+        return tool_version_result{.exit_code = 0, .version = version, .path = path};
     } else
-        return tool_version_result{.exit_code = exit_code, .version = nullopt};
+        return tool_version_result{.exit_code = r.exit_code, .version = nullopt, .path = path};
 }
 
-template <int... i>
-auto tools_versions(index_sequence<i...>) {
-    return array<tool_version_result, size_t(Lang::Count)>{tool_version<Lang(i)>()...};
+// Probes all toolchains concurrently; versions of binaries that haven't changed since the last run come from the cache.
+template <size_t... i>
+auto tools_versions(const filesystem::path & cache_path, index_sequence<i...>) {
+    auto cache = tool_cache::load(cache_path);
+
+    array probes = {async(launch::async, [&] { return tool_version<Lang(i)>(cache); })...};
+    const array<tool_version_result, size_t(Lang::Count)> versions{probes[i].get()...};
+
+    for(auto & r : versions)
+        if(r.version && r.path && !r.cached)
+            if(const auto key = tool_cache::key_of(*r.path))
+                cache[*key] = *r.version;
+    tool_cache::save(cache_path, cache);
+    return versions;
 }
 
-template <int... i>
+template <size_t... i>
 void print_tools_versions(const auto & versions, index_sequence<i...>) {
     auto print_one = [&](Lang l) {
         const auto & r = versions[l];
         if(r.version)
-            println("{}: {}", lang_name(l), *r.version);
+            println("{}: {} ({}{})",
+                    lang_name(l),
+                    *r.version,
+                    r.path ? r.path->string() : "not found",
+                    r.cached ? ", cached" : "");
         else
             println("Failed to obtain version for {} - returned {}", lang_name(l), r.exit_code);
     };
     (print_one(Lang(i)), ...);
 }
 
-template <int... i>
+template <size_t... i>
 string tools_versions_md(const auto & versions, index_sequence<i...>) {
     string s;
     s += "### Tools\n\n";
-    s += "| Language | Version |\n";
-    s += "|---|---|\n";
+    s += "| Language | Version | Path |\n";
+    s += "|---|---|---|\n";
 
     auto add_one = [&](Lang l) {
-        const auto & r = versions[l];
+        const auto & r    = versions[l];
+        const auto   path = r.path ? format("`{}`", md_escape_inline_code(r.path->string())) : string{"N/A"};
         if(r.version)
-            s += format("| {} | `{}` |\n", lang_name(l), md_escape_inline_code(*r.version));
+            s += format("| {} | `{}` | {} |\n", lang_name(l), md_escape_inline_code(*r.version), path);
         else
-            s += format("| {} | N/A (exit code {}) |\n", lang_name(l), r.exit_code);
+            s += format("| {} | N/A (exit code {}) | {} |\n", lang_name(l), r.exit_code, path);
     };
     (add_one(Lang(i)), ...);
     return s;
 }
 
+struct options {
+    optional<int>      num_fns;
+    filesystem::path   history_path = "results_history.tsv";
+    bool               history      = true;
+    bool               stabilize    = false;
+    bool               cache_tools  = true;
+    bool               phases       = false;
+    bool               calibrate    = true;
+    optional<uint64_t> shuffle_seed;
+    vector<unsigned>   pin_cpus;
+    filesystem::path   trace_path;
+    chart::options     chart_opts;
+    string             ab_target;
+    array<string, 2>   ab_cmds;
+    string             stress_target;
+    cache_mode         cache = cache_mode::as_is;
+    vector<unsigned>   limit_cpus; // CPU counts to sweep over, instead of the regular sweep
+    unsigned long long limit_memory = 0;
+    vector<unsigned>   body_stmts; // statements per function to sweep over, instead of the regular sweep
+    bool               precompiled = false;
+    bool               bad_args    = false;
+};
+
+// "512M", "4G", or plain bytes.
+static unsigned long long parse_bytes(sv s) {
+    unsigned long long n    = 0;
+    const auto         r    = from_chars(s.data(), s.data() + s.size(), n);
+    const sv           unit = r.ec == errc{} ? sv{r.ptr, s.data() + s.size()} : sv{};
+    if(unit == "K" || unit == "k")
+        return n << 10;
+    if(unit == "M" || unit == "m")
+        return n << 20;
+    if(unit == "G" || unit == "g")
+        return n << 30;
+    return n;
+}
+
+static vector<unsigned> parse_list(sv s) {
+    vector<unsigned> xs;
+    for(auto part : s | views::split(',')) {
+        unsigned x = 0;
+        if(from_chars(part.data(), part.data() + part.size(), x).ec == errc{})
+            xs.push_back(x);
+    }
+    return xs;
+}
+
+static options parse_options(int argc, char * argv[]) {
+    options o;
+    for(int a = 1; a < argc; ++a) {
+        const sv arg = argv[a];
+        if(arg == "--history" && a + 1 < argc)
+            o.history_path = argv[++a];
+        else if(arg == "--no-history")
+            o.history = false;
+        else if(arg == "--stabilize")
+            o.stabilize = true;
+        else if(arg == "--pin" && a + 1 < argc)
+            o.pin_cpus = parse_list(argv[++a]);
+        else if(arg == "--no-tool-cache")
+            o.cache_tools = false;
+        else if(arg == "--trace" && a + 1 < argc)
+            o.trace_path = argv[++a];
+        else if(arg == "--phases")
+            o.phases = true;
+        else if(arg == "--no-calibration")
+            o.calibrate = false;
+        else if(arg == "--cpus" && a + 1 < argc)
+            o.limit_cpus = parse_list(argv[++a]);
+        else if(arg == "--memory" && a + 1 < argc)
+            o.limit_memory = parse_bytes(argv[++a]);
+        else if(arg == "--body" && a + 1 < argc)
+            o.body_stmts = parse_list(argv[++a]);
+        else if(arg == "--precompiled")
+            o.precompiled = true;
+        else if(arg == "--shuffle")
+            o.shuffle_seed = random_device{}();
+        else if(arg == "--seed" && a + 1 < argc) {
+            const sv n = argv[++a];
+            from_chars(n.data(), n.data() + n.size(), o.shuffle_seed.emplace());
+        }
+        else if(arg == "--ab" && a + 3 < argc) {
+            o.ab_target = argv[++a];
+            o.ab_cmds   = {argv[a + 1], argv[a + 2]};
+            a += 2;
+            for(auto & cmd : o.ab_cmds)
+                o.bad_args |= !valid_ab_template(cmd);
+        } else if(arg == "--stress" && a + 1 < argc)
+            o.stress_target = argv[++a];
+        else if(arg == "--cache" && a + 1 < argc) {
+            const sv m = argv[++a];
+            if(m == "cold")
+                o.cache = cache_mode::cold;
+            else if(m == "warm")
+                o.cache = cache_mode::warm;
+            else if(m == "both")
+                o.cache = cache_mode::both;
+            else
+                println("Ignoring unknown cache mode: {}", m);
+        } else if(arg == "--log-y")
+            o.chart_opts.log_y = true;
+        else if(arg == "--max-points" && a + 1 < argc) {
+            const sv n = argv[++a];
+            from_chars(n.data(), n.data() + n.size(), o.chart_opts.max_points);
+        }
+        else if(int n = 0; from_chars(arg.data(), arg.data() + arg.size(), n).ec == errc{})
+            o.num_fns = n;
+        else
+            println("Ignoring unknown argument: {}", arg);
+    }
+    // Resolve before switching to the temp dir, so the history outlives it.
+    o.history_path = filesystem::absolute(o.history_path);
+    if(!o.trace_path.empty())
+        o.trace_path = filesystem::absolute(o.trace_path);
+    return o;
+}
+
 int main(int argc, char * argv[]) {
-    auto tmp_dir = filesystem::temp_directory_path();
-    filesystem::current_path(tmp_dir);
+    if(argc == 2 && sv{argv[1]} == "--noop")
+        return 0; // spawned by calibrate()
+
+    const auto opts = parse_options(argc, argv);
+    if(opts.bad_args)
+        return 1;
+    if(!opts.trace_path.empty())
+        trace::open(opts.trace_path);
+
+    // A directory of our own, so whatever a compile adds to it is an artifact of that compile.
+    const auto work_dir = filesystem::temp_directory_path() / "lang_benchmark";
+    filesystem::create_directories(work_dir);
+    filesystem::current_path(work_dir);
 
-    int        default_num_fns = 25'000;
-    const bool custom_num_fns  = argc == 2;
-    if(custom_num_fns)
-        from_chars(argv[1], argv[1] + strlen(argv[1]), default_num_fns);
+    // Held until main() returns, so the governor/power plan is switched back on every exit path.
+    optional<env::stabilizer> stabilizer;
+    env::stabilize_result     stabilized;
+    if(opts.stabilize) {
+        trace::span _{"stabilize"};
+        stabilized = stabilizer.emplace(env::stabilize_options{.cpus = opts.pin_cpus}).result();
+    } else if(!opts.pin_cpus.empty()) {
+        stabilized.pinned = env::pin(opts.pin_cpus);
+        println("{} to {} CPUs", stabilized.pinned ? "Pinned" : "Couldn't pin", opts.pin_cpus.size());
+    }
+    const auto machine = env::take_fingerprint(stabilized);
+    println("Environment: {}", env::to_string(machine));
 
-    constexpr auto all_langs = make_index_sequence<Lang::Count>{};
-    const auto     versions  = tools_versions(all_langs);
+    constexpr auto all_langs        = make_index_sequence<Lang::Count>{};
+    const auto     tools_cache_path = "lang_benchmark_tools.tsv";
+    if(error_code _; !opts.cache_tools)
+        filesystem::remove(tools_cache_path, _);
+    const auto versions = [&] {
+        trace::span _{"tools_versions"};
+        return tools_versions(tools_cache_path, all_langs);
+    }();
     print_tools_versions(versions, all_langs);
 
-    vector num_fns_to_measure = {default_num_fns};
-    if(!custom_num_fns) {
+    vector num_fns_to_measure = {opts.num_fns.value_or(25'000)};
+    if(!opts.num_fns) {
         num_fns_to_measure = {10, 1000};
         for(int num_fns = 2000; num_fns < 32000; num_fns += 1000)
             num_fns_to_measure.push_back(num_fns);
     }
 
-    array<vector<chart::point>, size_t(Lang::Count)> pts_by_lang;
-    for(auto & v : pts_by_lang)
+    const auto run = format("{:%FT%TZ}", chrono::floor<chrono::seconds>(chrono::system_clock::now()));
+
+    const auto variants = make_variants(all_langs);
+
+    auto finish = [&](sv md_path) {
+        println("Done. Results are written to {}.", md_path);
+        if(!opts.trace_path.empty()) {
+            trace::close();
+            println("Trace is written to {}.", opts.trace_path.string());
+        }
+        return 0;
+    };
+
+    if(opts.precompiled) {
+        const auto md      = precompiled_sweep(num_fns_to_measure, opts.chart_opts, all_langs);
+        const auto md_path = "results_precompiled.md";
+        ofstream{md_path} << format(
+          "{}\n\n{}\n\n{}", env::md_fingerprint(machine), tools_versions_md(versions, all_langs), md);
+        return finish(md_path);
+    }
+
+    if(!opts.body_stmts.empty()) {
+        const auto sizes = opts.num_fns ? vector{*opts.num_fns} : vector<int>(begin(GRID_NUM_FNS), end(GRID_NUM_FNS));
+        const auto md      = sweep_2d(variants, sizes, opts.body_stmts, all_langs);
+        const auto md_path = "results_2d.md";
+        ofstream{md_path} << format(
+          "{}\n\n{}\n\n{}", env::md_fingerprint(machine), tools_versions_md(versions, all_langs), md);
+        return finish(md_path);
+    }
+
+    if(!opts.limit_cpus.empty()) {
+        const auto md =
+          limits_sweep(variants, num_fns_to_measure, opts.limit_cpus, opts.limit_memory, opts.chart_opts, all_langs);
+        const auto md_path = "results_limits.md";
+        ofstream{md_path} << format(
+          "{}\n\n{}\n\n{}", env::md_fingerprint(machine), tools_versions_md(versions, all_langs), md);
+        return finish(md_path);
+    }
+
+    if(!opts.stress_target.empty()) {
+        const auto v = ranges::find(variants, opts.stress_target, &variant::label);
+        if(v == end(variants)) {
+            println("Unknown stress target {}.", opts.stress_target);
+            return 1;
+        }
+        const unsigned cpus    = machine.affinity_cpus ? machine.affinity_cpus : max(machine.cores, 1u);
+        const auto     md      = stress(*v, opts.num_fns.value_or(STRESS_NUM_FNS), cpus, all_langs);
+        const auto     md_path = "results_stress.md";
+        ofstream{md_path} << format("{}\n\n{}", env::md_fingerprint(machine), md);
+        return finish(md_path);
+    }
+
+    if(!opts.ab_target.empty()) {
+        const auto v = ranges::find(variants, opts.ab_target, &variant::label);
+        if(v == end(variants)) {
+            println("Unknown A/B target {}.", opts.ab_target);
+            return 1;
+        }
+        const auto md      = ab_compare(*v, opts.ab_cmds, num_fns_to_measure, all_langs);
+        const auto md_path = "results_ab.md";
+        ofstream{md_path} << format("{}\n\n{}", env::md_fingerprint(machine), md);
+        return finish(md_path);
+    }
+
+    vector<vector<chart::point>> pts_by_variant(variants.size());
+    for(auto & v : pts_by_variant)
         v.reserve(num_fns_to_measure.size());
+    vector<vector<chart::point>> artifact_pts(variants.size()), io_pts(variants.size()), syscall_pts(variants.size());
+    vector<vector<chart::point>> warm_pts(variants.size()), benefit_pts(variants.size());
+    const auto                   mode = opts.cache == cache_mode::both ? cache_mode::cold : opts.cache;
+
+    optional<calibration> cal;
+    if(opts.calibrate)
+        cal = calibrate(variants, mode, all_langs);
+    vector<history::entry> entries;
+
+    using phase_pts_t = array<vector<chart::point>, timings::fields.size()>;
+    array<phase_pts_t, size_t(Lang::Count)> phase_pts_by_lang;
+
+    results_by_size shuffled;
+    if(opts.shuffle_seed) {
+        println("\nShuffling all jobs with seed {}.", *opts.shuffle_seed);
+        shuffled = bench_shuffled(
+          num_fns_to_measure, variants, mode, *opts.shuffle_seed, "results_jobs.tsv", run, all_langs);
+    }
 
     for(auto num_fns : num_fns_to_measure) {
-        println("\nGenerating bench sources with {} functions in {}:", num_fns, tmp_dir.string());
-        const auto ms = bench_once(num_fns, all_langs);
-        [&]<int... i>(index_sequence<i...>) { ((pts_by_lang[i].push_back({num_fns, ms[i]})), ...); }(all_langs);
+        if(!opts.shuffle_seed)
+            println("\nGenerating bench sources with {} functions in {}:", num_fns, work_dir.string());
+        const auto samples =
+          opts.shuffle_seed ? std::move(shuffled[num_fns]) : bench_once(num_fns, variants, mode, all_langs);
+        if(opts.cache == cache_mode::both) {
+            const auto warm = bench_once(num_fns, variants, cache_mode::warm, all_langs);
+            for(size_t v = 0; v < variants.size(); ++v) {
+                const auto w = warm[v] ? optional{stats::median(warm[v]->ms)} : nullopt;
+                const auto c = samples[v] ? optional{stats::median(samples[v]->ms)} : nullopt;
+                warm_pts[v].push_back({num_fns, w});
+                benefit_pts[v].push_back({num_fns, w && c ? optional{*c / *w} : nullopt});
+                entries.push_back({.run        = run,
+                                   .host       = machine.host,
+                                   .lang       = variants[v].label + string{cache_suffix(cache_mode::warm)},
+                                   .version    = versions[variants[v].lang].version.value_or(""),
+                                   .num_fns    = num_fns,
+                                   .samples_ms = warm[v] ? warm[v]->ms : samples_t{}});
+            }
+        }
+
+        for(size_t v = 0; v < variants.size(); ++v) {
+            const auto & s = samples[v];
+            if(s) {
+                const auto ci = stats::median_ci(s->ms);
+                pts_by_variant[v].push_back({num_fns, stats::median(s->ms), ci.lo, ci.hi});
+
+                // Throughput per sample first, so a slow outlier doesn't pair with another sample's byte count.
+                samples_t mb_per_s(s->ms.size());
+                for(size_t k = 0; k < s->ms.size(); ++k)
+                    mb_per_s[k] = s->io_bytes[k] / 1e3 / s->ms[k];
+                artifact_pts[v].push_back({num_fns, stats::median(s->artifact_bytes) / num_fns});
+                io_pts[v].push_back({num_fns, stats::median(mb_per_s)});
+                syscall_pts[v].push_back({num_fns, stats::median(s->io_syscalls)});
+            } else {
+                pts_by_variant[v].push_back({num_fns, nullopt});
+                artifact_pts[v].push_back({num_fns, nullopt});
+                io_pts[v].push_back({num_fns, nullopt});
+                syscall_pts[v].push_back({num_fns, nullopt});
+            }
+            entries.push_back({.run        = run,
+                               .host       = machine.host,
+                               .lang       = variants[v].label + string{cache_suffix(mode)},
+                               .version    = versions[variants[v].lang].version.value_or(""),
+                               .num_fns    = num_fns,
+                               .samples_ms = s ? s->ms : samples_t{}});
+        }
+
+        if(opts.phases) {
+            auto add_phases = [&]<Lang L>() {
+                if constexpr(has_timings<L>) {
+                    if(opts.shuffle_seed) // the shuffled jobs left some other size behind
+                        gen_bench<L>(format("bench{}", LangSpec<L>::Ext), num_fns);
+                    const auto p = phase_times<L>(num_fns);
+                    for(size_t k = 0; k < timings::fields.size(); ++k)
+                        phase_pts_by_lang[L][k].push_back({num_fns, p ? (*p).*timings::fields[k].second : nullopt});
+                }
+            };
+            [&]<size_t... i>(index_sequence<i...>) { (add_phases.template operator()<Lang(i)>(), ...); }(all_langs);
+        }
+    }
+
+    vector<chart::series> series, artifact_series, io_series, syscall_series, warm_series, benefit_series;
+    for(size_t v = 0; v < variants.size(); ++v) {
+        series.push_back({variants[v].label, variants[v].color, pts_by_variant[v]});
+        warm_series.push_back({variants[v].label, variants[v].color, warm_pts[v]});
+        benefit_series.push_back({variants[v].label, variants[v].color, benefit_pts[v]});
+        artifact_series.push_back({variants[v].label, variants[v].color, artifact_pts[v]});
+        io_series.push_back({variants[v].label, variants[v].color, io_pts[v]});
+        syscall_series.push_back({variants[v].label, variants[v].color, syscall_pts[v]});
+    }
+
+    // Linker-swept toolchains: link time is the full build minus the compile-only build of the same source.
+    vector<vector<chart::point>> link_pts;
+    vector<chart::series>        link_series;
+    link_pts.reserve(variants.size()); // series keep spans into it
+    for(size_t v = 0; v < variants.size(); ++v) {
+        if(variants[v].linker.empty())
+            continue;
+        const auto base =
+          ranges::find_if(variants, [&](const variant & o) { return o.compile_only && o.lang == variants[v].lang; });
+        if(base == end(variants))
+            continue;
+        const auto & base_pts = pts_by_variant[size_t(base - begin(variants))];
+        auto &       pts      = link_pts.emplace_back();
+        for(size_t k = 0; k < pts_by_variant[v].size(); ++k) {
+            const auto & total   = pts_by_variant[v][k].y;
+            const auto & compile = base_pts[k].y;
+            pts.push_back({pts_by_variant[v][k].x, total && compile ? optional{*total - *compile} : nullopt});
+        }
+        link_series.push_back({variants[v].label, variants[v].color, pts});
     }
+    // Raw times minus the harness overhead, and minus each toolchain's floor (which includes that overhead).
+    string calibration_section;
+    if(cal) {
+        auto minus = [](span<const chart::point> pts, optional<double> by) {
+            vector<chart::point> out;
+            for(auto & p : pts)
+                out.push_back({p.x, p.y && by ? optional{*p.y - *by} : nullopt});
+            return out;
+        };
+        vector<vector<chart::point>> net_pts, above_floor_pts;
+        vector<chart::series>        net_series, above_floor_series;
+        for(size_t v = 0; v < variants.size(); ++v) {
+            net_pts.push_back(minus(pts_by_variant[v], cal->harness_ms));
+            above_floor_pts.push_back(minus(pts_by_variant[v], cal->floor_ms[v]));
+        }
+        for(size_t v = 0; v < variants.size(); ++v) {
+            net_series.push_back({variants[v].label, variants[v].color, net_pts[v]});
+            above_floor_series.push_back({variants[v].label, variants[v].color, above_floor_pts[v]});
+        }
+        calibration_section = format("\n\n{}\n\n{}\n\n{}",
+                                     calibration_md(*cal, variants),
+                                     chart::md_pivot(net_series, "### Results minus harness overhead", "ms"),
+                                     chart::md_pivot(above_floor_series, "### Results minus toolchain floor", "ms"));
+    }
+
+    string cache_md;
+    if(opts.cache == cache_mode::both)
+        cache_md = format("\n\n{}\n\n{}",
+                          chart::md_pivot(warm_series, "### Cache-hit time", "ms"),
+                          chart::md_pivot(benefit_series,
+                                          "### Caching benefit",
+                                          "x",
+                                          "Cold time (salted source, empty caches) over cache-hit time; above 1 means "
+                                          "the toolchain's cache pays off"));
 
-    array<chart::series, size_t(Lang::Count)> series{};
-    [&]<int... i>(index_sequence<i...>) {
-        ((series[i] = chart::series{lang_name(Lang(i)), gh_color(Lang(i)), span<const chart::point>{pts_by_lang[i]}}),
-         ...);
-    }(all_langs);
+    string link_md;
+    if(!link_series.empty())
+        link_md = "\n\n" + chart::md_pivot(link_series, "### Link time (build - compile only)", "ms");
 
-    const auto md_path = "results.md";
-    ofstream{"results.svg"} << chart::svg_lines(series, "compiler_benchmark — compile time vs functions");
-    ofstream{md_path} << format("![](results.svg)\n\n{}\n\n{}",
-                                tools_versions_md(versions, all_langs),
-                                chart::md_pivot(series, "### Results", "ms"));
+    string phases_md;
+    for(size_t k = 0; opts.phases && k < timings::fields.size(); ++k) {
+        vector<chart::series> phase_series;
+        for(size_t l = 0; l < size_t(Lang::Count); ++l)
+            if(!phase_pts_by_lang[l][k].empty())
+                phase_series.push_back({lang_name(Lang(l)), gh_color(Lang(l)), phase_pts_by_lang[l][k]});
+        phases_md +=
+          "\n\n" + chart::md_pivot(phase_series, format("### {} time (self-reported)", timings::fields[k].first), "ms");
+    }
+
+    string changes_md;
+    if(opts.history) {
+        trace::span _{"history"};
+        const auto  past    = history::load(opts.history_path);
+        const auto  changes = history::compare(past, entries);
+        for(auto & c : changes)
+            if(c.v != history::verdict::same)
+                println("{} {} @ {} functions: {:.3f}ms -> {:.3f}ms (p={:.3f}, {} -> {})",
+                        c.v == history::verdict::regression ? "Regression:" : "Improvement:",
+                        c.lang,
+                        c.num_fns,
+                        c.old_ms,
+                        c.new_ms,
+                        c.p_value,
+                        c.old_version,
+                        c.new_version);
+        changes_md = "\n\n" + history::md_changes(changes, "### Changes vs previous run");
+        history::append(opts.history_path, entries, format("{}\t{}", run, env::to_string(machine)));
+    }
+
+    string order_note;
+    if(opts.shuffle_seed)
+        order_note = format("Time in ms (lower is better). Samples of all languages and sizes ran in a random order "
+                            "(seed {}), every one of them is in `results_jobs.tsv`",
+                            *opts.shuffle_seed);
+
+    const auto results_caption = format("### Results{}", cache_suffix(mode));
+    const auto md_path         = "results.md";
+    {
+        trace::span _{"report"};
+        auto results_opts           = opts.chart_opts;
+        results_opts.compile_header = true;
+        ofstream{"results.svg"} << chart::svg_lines(
+          series, "compiler_benchmark — compile time vs functions", results_opts);
+        auto io_opts   = opts.chart_opts;
+        io_opts.y_unit = "bytes/fn";
+        ofstream{"results_artifacts.svg"} << chart::svg_lines(artifact_series, "artifact bytes per function", io_opts);
+        io_opts.y_unit = "MB/s";
+        ofstream{"results_io.svg"} << chart::svg_lines(io_series, "I/O throughput (all syscalls)", io_opts);
+
+        const auto io_md = format(
+          "\n\n![](results_artifacts.svg)\n\n{}\n\n![](results_io.svg)\n\n{}\n\n{}",
+          chart::md_pivot(artifact_series,
+                          "### Artifact size per function",
+                          "bytes",
+                          "Bytes left in the work dir by one compile (executable, objects, debug info), per function"),
+          chart::md_pivot(io_series,
+                          "### I/O throughput (all syscalls)",
+                          "MB/s",
+                          "Bytes read + written by the compiler and its children through any read/write call (files, "
+                          "pipes, terminals; not only disk), per second of compile time"),
+          chart::md_pivot(syscall_series,
+                          "### I/O calls per compile",
+                          "calls",
+                          "Read/write syscalls on Linux, all I/O operations of the job on Windows"));
+        ofstream{md_path} << format("![](results.svg)\n\n{}\n\n{}\n\n{}{}{}{}{}{}{}",
+                                    env::md_fingerprint(machine),
+                                    tools_versions_md(versions, all_langs),
+                                    chart::md_pivot(series, results_caption, "ms", order_note),
+                                    calibration_section,
+                                    cache_md,
+                                    link_md,
+                                    io_md,
+                                    phases_md,
+                                    changes_md);
+    }
 
-    println("Done. Results are written to {}.", md_path);
-    return 0;
+    return finish(md_path);
 }
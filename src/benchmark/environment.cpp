@@ -0,0 +1,375 @@
+#include "environment.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <powrprof.h>
+#pragma comment(lib, "PowrProf.lib")
+#else
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#endif
+
+#include <bit>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <print>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace env {
+namespace {
+// Total and idle CPU time since boot, in arbitrary but consistent units.
+struct cpu_times {
+    unsigned long long total = 0;
+    unsigned long long idle  = 0;
+};
+optional<cpu_times> read_cpu_times();
+string              read_governor();
+saved_governor      save_governor();
+bool                restore_governor(const saved_governor & g);
+bool                set_performance_governor();
+bool                raise_priority();
+
+double busy_fraction(chrono::milliseconds window) {
+    const auto a = read_cpu_times();
+    this_thread::sleep_for(window);
+    const auto b = read_cpu_times();
+    if(!a || !b || b->total <= a->total)
+        return 0.0;
+    return 1.0 - double(b->idle - a->idle) / double(b->total - a->total);
+}
+
+void wait_for_idle(const stabilize_options & o) {
+    const auto deadline = chrono::steady_clock::now() + o.idle_timeout;
+    for(;;) {
+        const double busy = busy_fraction(chrono::milliseconds{1000});
+        if(busy <= o.max_busy) {
+            println("Stabilize: system is idle ({:.1f}% busy)", busy * 100.0);
+            break;
+        }
+        if(chrono::steady_clock::now() >= deadline) {
+            println("Stabilize: gave up waiting for idle ({:.1f}% busy)", busy * 100.0);
+            break;
+        }
+        println("Stabilize: waiting for idle ({:.1f}% busy)", busy * 100.0);
+    }
+}
+} // namespace
+
+string to_string(const stabilize_result & s) {
+    string steps;
+    for(auto [done, name] : {pair{s.governor, "governor"}, pair{s.pinned, "pinned"}, pair{s.priority, "priority"}})
+        if(done)
+            steps += steps.empty() ? name : format(", {}", name);
+    return steps.empty() ? "no" : steps;
+}
+
+string md_fingerprint(const fingerprint & f) {
+    string s;
+    s += "### Environment\n\n";
+    s += "| | |\n";
+    s += "|---|---|\n";
+    s += format("| Host | {} |\n", f.host);
+    s += format("| CPU | {} |\n", f.cpu);
+    s += format("| Cores | {} ({} usable) |\n", f.cores, f.affinity_cpus);
+    s += format("| Kernel | {} |\n", f.kernel);
+    s += format("| Governor | {} |\n", f.governor);
+    s += format("| Memory | {:.1f} GiB |\n", double(f.memory_bytes) / double(1ull << 30));
+    s += format("| Stabilized | {} |\n", to_string(f.stabilized));
+    return s;
+}
+
+string to_string(const fingerprint & f) {
+    return format("host={}; cpu={}; cores={}; usable={}; kernel={}; governor={}; memory={}; stabilized={}",
+                  f.host,
+                  f.cpu,
+                  f.cores,
+                  f.affinity_cpus,
+                  f.kernel,
+                  f.governor,
+                  f.memory_bytes,
+                  to_string(f.stabilized));
+}
+
+#ifdef _WIN32
+
+struct saved_governor {
+    optional<GUID> scheme;
+};
+
+bool pin(const vector<unsigned> & cpus) {
+    DWORD_PTR mask = 0;
+    for(unsigned c : cpus)
+        if(c < sizeof(mask) * 8)
+            mask |= DWORD_PTR{1} << c;
+    // Affinity is inherited by child processes.
+    return mask && SetProcessAffinityMask(GetCurrentProcess(), mask);
+}
+
+namespace {
+// GUID_MIN_POWER_SAVINGS, a.k.a. the "High performance" power plan.
+constexpr GUID HIGH_PERFORMANCE = {0x8c5e7fda, 0xe8bf, 0x4a96, {0x9a, 0x85, 0xa6, 0xe2, 0x3a, 0x8c, 0x63, 0x5c}};
+
+string narrow(const wchar_t * ws) {
+    const int n = WideCharToMultiByte(CP_UTF8, 0, ws, -1, nullptr, 0, nullptr, nullptr);
+    if(n <= 1)
+        return {};
+    string s(size_t(n - 1), '\0');
+    WideCharToMultiByte(CP_UTF8, 0, ws, -1, s.data(), n, nullptr, nullptr);
+    return s;
+}
+
+unsigned long long to_ull(FILETIME ft) { return (unsigned long long)ft.dwHighDateTime << 32 | ft.dwLowDateTime; }
+
+optional<cpu_times> read_cpu_times() {
+    FILETIME idle{}, kernel{}, user{};
+    if(!GetSystemTimes(&idle, &kernel, &user))
+        return nullopt;
+    // Kernel time includes idle time.
+    return cpu_times{.total = to_ull(kernel) + to_ull(user), .idle = to_ull(idle)};
+}
+
+string read_governor() {
+    GUID * scheme = nullptr;
+    if(PowerGetActiveScheme(nullptr, &scheme) != ERROR_SUCCESS)
+        return "unknown";
+    wchar_t     name[256]{};
+    DWORD       size = sizeof(name);
+    const DWORD rc   = PowerReadFriendlyName(nullptr, scheme, nullptr, nullptr, reinterpret_cast<UCHAR *>(name), &size);
+    LocalFree(scheme);
+    return rc == ERROR_SUCCESS ? narrow(name) : "unknown";
+}
+
+saved_governor save_governor() {
+    saved_governor g;
+    GUID *         scheme = nullptr;
+    if(PowerGetActiveScheme(nullptr, &scheme) == ERROR_SUCCESS) {
+        g.scheme = *scheme;
+        LocalFree(scheme);
+    }
+    return g;
+}
+
+// Only touches the plan if it was changed; returns whether it was.
+bool restore_governor(const saved_governor & g) {
+    if(!g.scheme)
+        return false;
+    GUID * active = nullptr;
+    if(PowerGetActiveScheme(nullptr, &active) == ERROR_SUCCESS) {
+        const bool same = IsEqualGUID(*active, *g.scheme);
+        LocalFree(active);
+        if(same)
+            return false;
+    }
+    if(PowerSetActiveScheme(nullptr, &*g.scheme) != ERROR_SUCCESS)
+        println("Stabilize: couldn't restore the power plan");
+    return true;
+}
+
+bool set_performance_governor() { return PowerSetActiveScheme(nullptr, &HIGH_PERFORMANCE) == ERROR_SUCCESS; }
+
+// exec() propagates the priority class explicitly, since children don't inherit it.
+bool raise_priority() { return SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS); }
+} // namespace
+
+fingerprint take_fingerprint(const stabilize_result & stabilized) {
+    fingerprint f{.cores = thread::hardware_concurrency(), .governor = read_governor(), .stabilized = stabilized};
+
+    char  host[MAX_COMPUTERNAME_LENGTH + 1]{};
+    DWORD host_size = sizeof(host);
+    f.host          = GetComputerNameA(host, &host_size) ? host : "unknown";
+
+    char  cpu[256]{};
+    DWORD cpu_size = sizeof(cpu);
+    if(RegGetValueA(HKEY_LOCAL_MACHINE,
+                    R"(HARDWARE\DESCRIPTION\System\CentralProcessor\0)",
+                    "ProcessorNameString",
+                    RRF_RT_REG_SZ,
+                    nullptr,
+                    cpu,
+                    &cpu_size) == ERROR_SUCCESS)
+        f.cpu = cpu;
+
+    // GetVersionEx lies to unmanifested apps, RtlGetVersion doesn't.
+    using rtl_get_version_t = LONG(WINAPI *)(OSVERSIONINFOW *);
+    OSVERSIONINFOW v{.dwOSVersionInfoSize = sizeof(v)};
+    if(const auto rtl_get_version =
+         reinterpret_cast<rtl_get_version_t>(GetProcAddress(GetModuleHandleA("ntdll.dll"), "RtlGetVersion"));
+       rtl_get_version && rtl_get_version(&v) == 0)
+        f.kernel = format("Windows {}.{}.{}", v.dwMajorVersion, v.dwMinorVersion, v.dwBuildNumber);
+
+    MEMORYSTATUSEX mem{.dwLength = sizeof(mem)};
+    if(GlobalMemoryStatusEx(&mem))
+        f.memory_bytes = mem.ullTotalPhys;
+
+    DWORD_PTR process_mask = 0, system_mask = 0;
+    if(GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+        f.affinity_cpus = unsigned(popcount(process_mask));
+
+    return f;
+}
+
+#else
+
+struct saved_governor {
+    vector<pair<filesystem::path, string>> files; // scaling_governor -> what it was
+};
+
+bool pin(const vector<unsigned> & cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(unsigned c : cpus)
+        if(c < CPU_SETSIZE)
+            CPU_SET(c, &set);
+    // Affinity is inherited across fork/exec.
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+namespace {
+const filesystem::path CPUS = "/sys/devices/system/cpu";
+
+string read_line(const filesystem::path & p) {
+    string line;
+    ifstream{p} >> line;
+    return line;
+}
+
+vector<filesystem::path> governor_files() {
+    vector<filesystem::path> fs;
+    error_code               ec;
+    for(auto & e : filesystem::directory_iterator{CPUS, ec})
+        if(const auto g = e.path() / "cpufreq" / "scaling_governor"; filesystem::exists(g, ec))
+            fs.push_back(g);
+    return fs;
+}
+
+optional<cpu_times> read_cpu_times() {
+    ifstream in{"/proc/stat"};
+    string   cpu;
+    in >> cpu;
+    if(cpu != "cpu")
+        return nullopt;
+    // user nice system idle iowait irq softirq steal
+    cpu_times          t;
+    unsigned long long v = 0;
+    for(int i = 0; i < 8 && in >> v; ++i) {
+        t.total += v;
+        if(i == 3 || i == 4)
+            t.idle += v;
+    }
+    return t;
+}
+
+string read_governor() {
+    string governor;
+    for(auto & g : governor_files()) {
+        const auto cur = read_line(g);
+        if(governor.empty())
+            governor = cur;
+        else if(cur != governor)
+            return "mixed";
+    }
+    return governor.empty() ? "unknown" : governor;
+}
+
+saved_governor save_governor() {
+    saved_governor g;
+    for(auto & f : governor_files())
+        g.files.emplace_back(f, read_line(f));
+    return g;
+}
+
+// Only rewrites the CPUs that were switched; returns whether there were any.
+bool restore_governor(const saved_governor & g) {
+    bool changed = false;
+    for(auto & [f, governor] : g.files) {
+        if(read_line(f) == governor)
+            continue;
+        changed = true;
+        if(!(ofstream{f} << governor << flush))
+            println("Stabilize: couldn't restore {} to {}", f.string(), governor);
+    }
+    return changed;
+}
+
+bool set_performance_governor() {
+    const auto fs = governor_files();
+    bool       ok = !fs.empty();
+    for(auto & g : fs)
+        ok &= bool(ofstream{g} << "performance" << flush);
+    return ok;
+}
+
+bool raise_priority() { return setpriority(PRIO_PROCESS, 0, -10) == 0; }
+
+string cpu_model() {
+    ifstream in{"/proc/cpuinfo"};
+    for(string line; getline(in, line);)
+        if(line.starts_with("model name"))
+            if(const auto colon = line.find(':'); colon != string::npos)
+                return line.substr(line.find_first_not_of(' ', colon + 1));
+    return "unknown";
+}
+} // namespace
+
+fingerprint take_fingerprint(const stabilize_result & stabilized) {
+    fingerprint f{.cpu        = cpu_model(),
+                  .cores      = thread::hardware_concurrency(),
+                  .governor   = read_governor(),
+                  .stabilized = stabilized};
+
+    char host[256]{};
+    f.host = gethostname(host, sizeof(host) - 1) == 0 ? host : "unknown";
+
+    if(utsname u{}; uname(&u) == 0)
+        f.kernel = format("{} {}", u.sysname, u.release);
+
+    f.memory_bytes = (unsigned long long)sysconf(_SC_PHYS_PAGES) * (unsigned long long)sysconf(_SC_PAGE_SIZE);
+
+    cpu_set_t set;
+    if(sched_getaffinity(0, sizeof(set), &set) == 0)
+        f.affinity_cpus = unsigned(CPU_COUNT(&set));
+
+    return f;
+}
+
+#endif
+
+stabilizer::stabilizer(const stabilize_options & o) : saved_{make_unique<saved_governor>(save_governor())} {
+    const auto governor = read_governor();
+    result_.governor    = set_performance_governor();
+    if(result_.governor)
+        println("Stabilize: governor {} -> {}", governor, read_governor());
+    else
+        println("Stabilize: couldn't switch governor (is {})", governor);
+
+    vector<unsigned> cpus = o.cpus;
+    if(cpus.empty())
+        for(unsigned c = 1; c < thread::hardware_concurrency(); ++c)
+            cpus.push_back(c);
+    if(!cpus.empty()) {
+        result_.pinned = pin(cpus);
+        println("Stabilize: {} to {} CPUs", result_.pinned ? "pinned" : "couldn't pin", cpus.size());
+    }
+
+    result_.priority = raise_priority();
+    println("Stabilize: {}", result_.priority ? "raised priority" : "couldn't raise priority");
+
+    wait_for_idle(o);
+}
+
+// Not just when result_.governor is set: a partial switch (some CPUs refused) has still changed the others.
+stabilizer::~stabilizer() {
+    if(restore_governor(*saved_))
+        println("Stabilize: governor restored to {}", read_governor());
+}
+
+} // namespace env
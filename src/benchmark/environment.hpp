@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace env {
+
+// What stabilization actually managed; every step is best-effort.
+struct stabilize_result {
+    bool governor = false; // switched to the performance governor/power plan
+    bool pinned   = false;
+    bool priority = false;
+};
+
+// Everything about the machine that is known to move the numbers.
+struct fingerprint {
+    std::string        host;
+    std::string        cpu;
+    unsigned           cores         = 0; // logical
+    unsigned           affinity_cpus = 0;
+    std::string        kernel;
+    std::string        governor; // CPU frequency governor or Windows power plan
+    unsigned long long memory_bytes = 0;
+    stabilize_result   stabilized;
+};
+
+struct stabilize_options {
+    std::vector<unsigned> cpus; // CPUs to pin the harness (and thus every child) to; empty: all but CPU 0
+    double                max_busy     = 0.05; // system-wide CPU utilization considered idle
+    std::chrono::seconds  idle_timeout = std::chrono::seconds{60};
+};
+
+struct saved_governor;
+
+// Switches to the performance governor/power plan, pins, raises priority and waits for the machine to go idle.
+// Every step is best-effort: failures (e.g. missing privileges) are reported and skipped. The governor/power plan is
+// machine-wide, so it is switched back on destruction.
+class stabilizer {
+  public:
+    explicit stabilizer(const stabilize_options & o);
+    ~stabilizer();
+    stabilizer(const stabilizer &)             = delete;
+    stabilizer & operator=(const stabilizer &) = delete;
+
+    const stabilize_result & result() const { return result_; }
+
+  private:
+    std::unique_ptr<saved_governor> saved_;
+    stabilize_result                result_;
+};
+
+// Pins the harness, and thus every child, to the given CPUs.
+bool pin(const std::vector<unsigned> & cpus);
+
+fingerprint take_fingerprint(const stabilize_result & stabilized);
+std::string to_string(const stabilize_result & s);
+std::string md_fingerprint(const fingerprint & f);
+std::string to_string(const fingerprint & f);
+
+} // namespace env
@@ -1,15 +1,46 @@
 #include "exec.hpp"
 
+#ifdef _WIN32
 #include <Windows.h>
 #include <consoleapi2.h>
+#else
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <fstream>
+#endif
 #include <algorithm>
+#include <bit>
+#include <cstdlib>
 #include <cstring>
+#include <ranges>
+#include <vector>
 
 using namespace std;
 
+#ifdef _WIN32
+
 namespace {
 void sanitize_terminal_output_inplace(string & s);
 
+exec_limits limits;
+
+DWORD_PTR first_cpus(unsigned n) {
+    DWORD_PTR process = 0, system = 0, mask = 0;
+    GetProcessAffinityMask(GetCurrentProcess(), &process, &system);
+    for(unsigned bit = 0; bit < sizeof(mask) * 8 && n; ++bit)
+        if(process & (DWORD_PTR{1} << bit)) {
+            mask |= DWORD_PTR{1} << bit;
+            --n;
+        }
+    return mask;
+}
+
 template <class F>
 struct defer_t {
     F f;
@@ -21,7 +52,7 @@ defer_t<F> defer(F f) {
 }
 } // namespace
 
-exec_result exec(string_view cmd, bool capture_stdout) {
+exec_result exec(string_view cmd, bool capture_stdout, const filesystem::path & cwd) {
     PROCESS_INFORMATION pi{};
     char                buf[4096];
     exec_result         result;
@@ -42,16 +73,59 @@ exec_result exec(string_view cmd, bool capture_stdout) {
         }
     };
 
+    // Children don't inherit the priority class, so pass along whatever env::stabilizer has set.
+    const DWORD  priority = GetPriorityClass(GetCurrentProcess());
+    const string dir      = cwd.string();
+    const char * work_dir = dir.empty() ? nullptr : dir.c_str();
+
     STARTUPINFOA si{.cb = sizeof(si)};
     if(!capture_stdout) {
-        if(!CreateProcessA(nullptr, buf, nullptr, nullptr, FALSE, 0, nullptr, nullptr, &si, &pi)) {
+        // The job accounts the I/O of the whole process tree (e.g. link.exe started by cl).
+        HANDLE job = CreateJobObjectA(nullptr, nullptr);
+        if(!CreateProcessA(
+             nullptr, buf, nullptr, nullptr, FALSE, priority | CREATE_SUSPENDED, nullptr, work_dir, &si, &pi)) {
             result.exit_code = GetLastError();
             result.std_out   = "exec(): CreateProcessA failed\n";
+            close_handle(job);
             return result;
         }
+        if(job) {
+            JOBOBJECT_EXTENDED_LIMIT_INFORMATION li{};
+            if(limits.cpus) {
+                li.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_AFFINITY;
+                li.BasicLimitInformation.Affinity = first_cpus(limits.cpus);
+            }
+            if(limits.memory_bytes) {
+                li.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_JOB_MEMORY;
+                li.JobMemoryLimit = SIZE_T(limits.memory_bytes);
+            }
+            if(li.BasicLimitInformation.LimitFlags)
+                SetInformationJobObject(job, JobObjectExtendedLimitInformation, &li, sizeof(li));
+            AssignProcessToJobObject(job, pi.hProcess);
+        }
+        ResumeThread(pi.hThread);
 
         WaitForSingleObject(pi.hProcess, INFINITE);
         GetExitCodeProcess(pi.hProcess, &result.exit_code);
+
+        // Commits past the limit fail instead of killing the process, so a failure close to the limit is possibly OOM.
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION used{};
+        if(job && limits.memory_bytes && result.exit_code != 0 &&
+           QueryInformationJobObject(job, JobObjectExtendedLimitInformation, &used, sizeof(used), nullptr) &&
+           used.PeakJobMemoryUsed >= limits.memory_bytes * 9 / 10)
+            result.oom = out_of_memory::possibly;
+
+        JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION acct{};
+        if(job && QueryInformationJobObject(
+                    job, JobObjectBasicAndIoAccountingInformation, &acct, sizeof(acct), nullptr)) {
+            result.io = {
+              .read_bytes  = acct.IoInfo.ReadTransferCount,
+              .write_bytes = acct.IoInfo.WriteTransferCount,
+              .syscalls    = acct.IoInfo.ReadOperationCount + acct.IoInfo.WriteOperationCount +
+                          acct.IoInfo.OtherOperationCount,
+            };
+        }
+        close_handle(job);
         close_handle(pi.hProcess);
         close_handle(pi.hThread);
         return result;
@@ -129,9 +203,9 @@ exec_result exec(string_view cmd, bool capture_stdout) {
                        nullptr,
                        nullptr,
                        FALSE,
-                       EXTENDED_STARTUPINFO_PRESENT,
-                       nullptr,
+                       EXTENDED_STARTUPINFO_PRESENT | priority,
                        nullptr,
+                       work_dir,
                        &siex.StartupInfo,
                        &pi_local))
         return fail("exec(): CreateProcessA failed\n");
@@ -192,6 +266,49 @@ exec_result exec(string_view cmd, bool capture_stdout) {
     return result;
 }
 
+namespace {
+optional<string> get_env(string_view name) {
+    char * value = nullptr;
+    size_t size  = 0;
+    if(_dupenv_s(&value, &size, string{name}.c_str()) != 0 || !value)
+        return nullopt;
+    string s = value;
+    free(value);
+    return s;
+}
+
+// An empty value removes the variable.
+void put_env(string_view name, const optional<string> & value) {
+    _putenv_s(string{name}.c_str(), value ? value->c_str() : "");
+}
+} // namespace
+
+applied_limits set_limits(const exec_limits & l) {
+    limits = l;
+    if(!l.cpus && !l.memory_bytes)
+        return {"none"};
+    DWORD_PTR process = 0, system = 0;
+    GetProcessAffinityMask(GetCurrentProcess(), &process, &system);
+    return {"job object", unsigned(popcount(l.cpus ? first_cpus(l.cpus) : process))};
+}
+
+filesystem::path current_executable() {
+    char        buf[MAX_PATH];
+    const DWORD n = GetModuleFileNameA(nullptr, buf, MAX_PATH);
+    return n && n < MAX_PATH ? filesystem::path{buf} : filesystem::path{};
+}
+
+namespace {
+optional<filesystem::path> search_path(string_view exe) {
+    const string name{exe};
+    char         buf[MAX_PATH];
+    const DWORD  n = SearchPathA(nullptr, name.c_str(), ".exe", MAX_PATH, buf, nullptr);
+    if(n == 0 || n >= MAX_PATH)
+        return nullopt;
+    return filesystem::path{buf};
+}
+} // namespace
+
 namespace {
 void sanitize_terminal_output_inplace(string & s) {
     auto   csi_final = [](unsigned char c) { return c >= 0x40 && c <= 0x7E; };
@@ -236,4 +353,403 @@ void sanitize_terminal_output_inplace(string & s) {
     }
     s.resize(w);
 }
-}
\ No newline at end of file
+}
+
+#else
+
+namespace {
+exec_limits      limits;
+cpu_set_t        limit_cpus;
+filesystem::path cgroup;       // leaf enforcing `limits`; empty when falling back to affinity + RLIMIT_AS
+string           cgroup_procs; // cgroup / "cgroup.procs", for the child to join without allocating
+filesystem::path cgroup_home;  // the harness's own cgroup, which it left for a leaf next to `cgroup`
+bool             enabled_controllers = false; // in cgroup_home, by us
+
+bool write_file(const filesystem::path & p, string_view s) {
+    ofstream f{p};
+    f << s << flush;
+    return f.good();
+}
+
+bool join(const filesystem::path & cg) { return write_file(cg / "cgroup.procs", to_string(getpid())); }
+
+unsigned long long oom_kills() {
+    ifstream f{cgroup / "memory.events"};
+    string   key;
+    for(unsigned long long v; f >> key >> v;)
+        if(key == "oom_kill")
+            return v;
+    return 0;
+}
+
+void release_cgroup() {
+    error_code ec;
+    if(!cgroup.empty())
+        filesystem::remove(cgroup, ec);
+    if(!cgroup_home.empty()) {
+        if(enabled_controllers)
+            write_file(cgroup_home / "cgroup.subtree_control", "-cpuset -memory");
+        join(cgroup_home);
+        filesystem::remove(cgroup_home / "lang_benchmark.harness", ec);
+    }
+    cgroup.clear();
+    cgroup_procs.clear();
+    cgroup_home.clear();
+    enabled_controllers = false;
+}
+
+// A cgroup can only hand controllers down while no process sits in it directly, so the harness first moves into a
+// leaf of its own, next to the leaf for the commands. That still fails when other processes share our cgroup (a
+// login shell's scope, say) or we may not write to it; then the caller falls back.
+bool make_cgroup(const string & cpus) {
+    ifstream self{"/proc/self/cgroup"};
+    string   line;
+    while(getline(self, line) && !line.starts_with("0::/")) {} // v1 hierarchies come first on hybrid setups
+    if(!line.starts_with("0::/"))
+        return false;
+    // The unified hierarchy is mounted on its own on pure v2 setups, and under unified/ on hybrid ones.
+    error_code       ec;
+    filesystem::path root = "/sys/fs/cgroup";
+    if(!filesystem::exists(root / "cgroup.controllers", ec))
+        root /= "unified";
+    const auto ours = root / line.substr(4);
+    string     available;
+    getline(ifstream{ours / "cgroup.controllers"}, available);
+    if(!available.contains("cpuset") || !available.contains("memory"))
+        return false;
+    const auto harness = ours / "lang_benchmark.harness";
+    const auto leaf    = ours / "lang_benchmark.bench";
+
+    filesystem::create_directory(harness, ec);
+    if(ec || !join(harness)) {
+        filesystem::remove(harness, ec);
+        return false;
+    }
+    cgroup_home = ours;
+
+    string enabled;
+    getline(ifstream{ours / "cgroup.subtree_control"}, enabled);
+    if(!enabled.contains("cpuset") || !enabled.contains("memory")) {
+        if(!write_file(ours / "cgroup.subtree_control", "+cpuset +memory")) {
+            release_cgroup();
+            return false;
+        }
+        enabled_controllers = true;
+    }
+
+    filesystem::create_directory(leaf, ec);
+    cgroup            = leaf; // for release_cgroup() to remove
+    const auto memory = limits.memory_bytes ? to_string(limits.memory_bytes) : string{"max"};
+    if(ec || !write_file(leaf / "cpuset.cpus", cpus) || !write_file(leaf / "memory.max", memory)) {
+        release_cgroup();
+        return false;
+    }
+    write_file(leaf / "memory.swap.max", limits.memory_bytes ? "0" : "max"); // OOM instead of swapping
+    cgroup_procs = (leaf / "cgroup.procs").string();
+    return true;
+}
+
+// Under RLIMIT_AS allocations just fail, and every runtime words that differently.
+bool mentions_allocation_failure(string s) {
+    ranges::transform(s, begin(s), [](unsigned char c) { return char(tolower(c)); });
+    for(string_view needle : {"out of memory",
+                              "memoryerror",
+                              "bad_alloc",
+                              "cannot allocate",
+                              "failed to allocate",
+                              "allocation failed",
+                              "memory exhausted",
+                              "not enough memory"})
+        if(s.contains(needle))
+            return true;
+    return false;
+}
+
+// Runs in the forked child, so only async-signal-safe calls.
+void apply_limits() {
+    if(!cgroup_procs.empty()) {
+        if(const int fd = open(cgroup_procs.c_str(), O_WRONLY); fd >= 0) {
+            [[maybe_unused]] const auto n = write(fd, "0", 1);
+            close(fd);
+        }
+        return;
+    }
+    if(limits.cpus)
+        sched_setaffinity(0, sizeof(limit_cpus), &limit_cpus);
+    if(limits.memory_bytes) {
+        const rlimit rl{limits.memory_bytes, limits.memory_bytes};
+        setrlimit(RLIMIT_AS, &rl);
+    }
+}
+
+// Splits a command line the way sh would for plain commands: words, quotes and backslashes. Anything that needs a
+// real shell (pipes, redirections, variables, globs, assignments) returns nullopt.
+optional<vector<string>> split_command(string_view cmd) {
+    vector<string> args;
+    string         arg;
+    bool           in_arg = false;
+    for(size_t i = 0; i < cmd.size(); ++i) {
+        const char c = cmd[i];
+        if(c == ' ' || c == '\t') {
+            if(in_arg)
+                args.push_back(std::move(arg));
+            arg.clear();
+            in_arg = false;
+            continue;
+        }
+        if(!in_arg && (c == '#' || c == '~'))
+            return nullopt;
+        in_arg = true;
+        if(c == '\'') {
+            const size_t end = cmd.find('\'', i + 1);
+            if(end == string_view::npos)
+                return nullopt;
+            arg.append(cmd.substr(i + 1, end - i - 1));
+            i = end;
+        } else if(c == '"') {
+            for(++i; i < cmd.size() && cmd[i] != '"'; ++i) {
+                if(cmd[i] == '$' || cmd[i] == '`')
+                    return nullopt;
+                if(cmd[i] == '\\' && i + 1 < cmd.size() && strchr("\"\\", cmd[i + 1]))
+                    ++i;
+                arg += cmd[i];
+            }
+            if(i == cmd.size())
+                return nullopt;
+        } else if(c == '\\') {
+            if(++i == cmd.size())
+                return nullopt;
+            arg += cmd[i];
+        } else if(strchr("|&;<>()$`*?[\n", c))
+            return nullopt;
+        else
+            arg += c;
+    }
+    if(in_arg)
+        args.push_back(std::move(arg));
+    if(args.empty() || args[0].contains('='))
+        return nullopt;
+    return args;
+}
+
+io_counters read_io_counters(pid_t pid) {
+    io_counters io;
+    ifstream    f{"/proc/" + to_string(pid) + "/io"};
+    string      key;
+    for(unsigned long long v; f >> key >> v;) {
+        if(key == "rchar:")
+            io.read_bytes = v;
+        else if(key == "wchar:")
+            io.write_bytes = v;
+        else if(key == "syscr:" || key == "syscw:")
+            io.syscalls += v;
+    }
+    return io;
+}
+} // namespace
+
+exec_result exec(string_view cmd, bool capture_stdout, const filesystem::path & cwd) {
+    exec_result result;
+
+    // Plain commands are split here and exec'd directly, so the timings include neither a shell's startup nor its
+    // parsing. Anything else goes through sh, which replaces itself with the command but has still started up.
+    auto           args = split_command(cmd);
+    const string   line = "exec " + string{cmd};
+    vector<char *> argv; // built before fork(), the child mustn't allocate
+    if(args) {
+        for(auto & a : *args)
+            argv.push_back(a.data());
+        argv.push_back(nullptr);
+    }
+
+    // Close-on-exec, so commands run concurrently (tools_versions) don't hold each other's pipes open; dup2 clears it
+    // on the child's own stdout/stderr.
+    int out[2] = {-1, -1};
+    if(capture_stdout && pipe2(out, O_CLOEXEC) != 0) {
+        result.exit_code = static_cast<unsigned long>(errno);
+        result.std_out   = "exec(): pipe failed\n";
+        return result;
+    }
+
+    const bool               limited          = !capture_stdout && (limits.cpus || limits.memory_bytes);
+    const unsigned long long oom_kills_before = limited && !cgroup.empty() ? oom_kills() : 0;
+
+    // Without the cgroup's OOM killer, stderr is passed through and scanned for allocation failures.
+    int err[2] = {-1, -1};
+    if(limited && limits.memory_bytes && cgroup.empty() && pipe2(err, O_CLOEXEC) != 0)
+        err[0] = err[1] = -1;
+
+    const pid_t pid = fork();
+    if(pid < 0) {
+        result.exit_code = static_cast<unsigned long>(errno);
+        result.std_out   = "exec(): fork failed\n";
+        if(capture_stdout) {
+            close(out[0]);
+            close(out[1]);
+        }
+        if(err[0] >= 0) {
+            close(err[0]);
+            close(err[1]);
+        }
+        return result;
+    }
+    if(pid == 0) {
+        if(err[0] >= 0) {
+            dup2(err[1], STDERR_FILENO);
+            close(err[0]);
+            close(err[1]);
+        }
+        if(capture_stdout) {
+            // Like ConPTY on Windows: stdout and stderr end up in the same stream.
+            dup2(out[1], STDOUT_FILENO);
+            dup2(out[1], STDERR_FILENO);
+            close(out[0]);
+            close(out[1]);
+        }
+        if(!cwd.empty() && chdir(cwd.c_str()) != 0)
+            _exit(127);
+        if(limited)
+            apply_limits();
+        if(args)
+            execvp(argv[0], argv.data());
+        else
+            execl("/bin/sh", "sh", "-c", line.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+
+    if(capture_stdout) {
+        close(out[1]);
+        char buf[4096];
+        for(;;) {
+            const ssize_t n = read(out[0], buf, sizeof(buf));
+            if(n > 0)
+                result.std_out.append(buf, size_t(n));
+            else if(n == 0 || errno != EINTR)
+                break;
+        }
+        close(out[0]);
+    }
+
+    string std_err;
+    if(err[0] >= 0) {
+        close(err[1]);
+        char buf[4096];
+        for(;;) {
+            const ssize_t n = read(err[0], buf, sizeof(buf));
+            if(n > 0) {
+                [[maybe_unused]] const auto w = write(STDERR_FILENO, buf, size_t(n));
+                std_err.append(buf, size_t(n));
+                if(std_err.size() > 1 << 16) // the failure is near the end
+                    std_err.erase(0, std_err.size() - (1 << 15));
+            } else if(n == 0 || errno != EINTR)
+                break;
+        }
+        close(err[0]);
+    }
+
+    // Leave the child a zombie until its I/O counters are read; they include the children it waited for.
+    siginfo_t si{};
+    while(waitid(P_PID, id_t(pid), &si, WEXITED | WNOWAIT) < 0 && errno == EINTR) {}
+    result.io = read_io_counters(pid);
+
+    int status = 0;
+    while(waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    result.exit_code = WIFEXITED(status) ? static_cast<unsigned long>(WEXITSTATUS(status))
+                                         : 128ul + static_cast<unsigned long>(WTERMSIG(status));
+    if(limited && !cgroup.empty() && oom_kills() > oom_kills_before)
+        result.oom = out_of_memory::killed;
+    else if(limited && limits.memory_bytes && cgroup.empty() && result.exit_code != 0) {
+        // SIGABRT: an uncaught std::bad_alloc; SIGSEGV: an unchecked null from malloc.
+        const int sig = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+        if(sig == SIGKILL || sig == SIGSEGV || sig == SIGABRT || mentions_allocation_failure(std_err))
+            result.oom = out_of_memory::possibly;
+    }
+    return result;
+}
+
+namespace {
+optional<string> get_env(string_view name) {
+    const char * value = getenv(string{name}.c_str());
+    return value ? optional<string>{value} : nullopt;
+}
+
+void put_env(string_view name, const optional<string> & value) {
+    if(value)
+        setenv(string{name}.c_str(), value->c_str(), 1);
+    else
+        unsetenv(string{name}.c_str());
+}
+} // namespace
+
+applied_limits set_limits(const exec_limits & l) {
+    release_cgroup();
+
+    limits = l;
+    if(!l.cpus && !l.memory_bytes)
+        return {"none"};
+
+    // The first l.cpus CPUs we may run on, as a mask for the fallback and as a list for cpuset.cpus.
+    cpu_set_t ours;
+    CPU_ZERO(&ours);
+    CPU_ZERO(&limit_cpus);
+    sched_getaffinity(0, sizeof(ours), &ours);
+    string   list;
+    unsigned n = 0;
+    for(unsigned c = 0; c < CPU_SETSIZE && (!l.cpus || n < l.cpus); ++c)
+        if(CPU_ISSET(c, &ours)) {
+            CPU_SET(c, &limit_cpus);
+            list += (n++ ? "," : "") + to_string(c);
+        }
+
+    return {make_cgroup(list) ? "cgroup v2" : "sched_setaffinity + RLIMIT_AS", n};
+}
+
+filesystem::path current_executable() {
+    error_code ec;
+    return filesystem::read_symlink("/proc/self/exe", ec);
+}
+
+namespace {
+optional<filesystem::path> search_path(string_view exe) {
+    auto is_executable = [](const filesystem::path & p) {
+        struct stat st {};
+        return stat(p.c_str(), &st) == 0 && S_ISREG(st.st_mode) && access(p.c_str(), X_OK) == 0;
+    };
+    if(exe.find('/') != string_view::npos)
+        return is_executable(exe) ? optional{filesystem::absolute(exe)} : nullopt;
+
+    const char * path = getenv("PATH");
+    for(string_view dir = path ? path : ""; !dir.empty();) {
+        const size_t colon = dir.find(':');
+        const auto   p     = filesystem::path{dir.substr(0, colon)} / exe;
+        if(is_executable(p))
+            return filesystem::absolute(p);
+        dir = colon == string_view::npos ? string_view{} : dir.substr(colon + 1);
+    }
+    return nullopt;
+}
+} // namespace
+
+#endif
+
+// PATH hits are usually symlinks (/usr/bin/cc, alternatives, version-manager shims), so the binary they lead to is
+// what gets reported and cached.
+optional<filesystem::path> which(string_view exe) {
+    const auto found = search_path(exe);
+    if(!found)
+        return nullopt;
+    error_code ec;
+    auto       real = filesystem::canonical(*found, ec);
+    return ec ? found : optional{std::move(real)};
+}
+
+void scoped_env::set(string_view name, string_view value) {
+    if(ranges::find(saved_, name, &decltype(saved_)::value_type::first) == end(saved_))
+        saved_.emplace_back(name, get_env(name));
+    put_env(name, string{value});
+}
+
+scoped_env::~scoped_env() {
+    for(auto & [name, value] : saved_ | views::reverse)
+        put_env(name, value);
+}
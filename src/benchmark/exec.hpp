@@ -1,11 +1,67 @@
 #pragma once
 
+#include <filesystem>
+#include <optional>
 #include <string_view>
 #include <string>
+#include <utility>
+#include <vector>
+
+// I/O of the command and the children it waited for, through any read/write call: files, pipes and terminals alike
+// (rchar/wchar of /proc/<pid>/io, the job's transfer counts on Windows), not only what reached the disk.
+struct io_counters {
+    unsigned long long read_bytes  = 0;
+    unsigned long long write_bytes = 0;
+    unsigned long long syscalls    = 0; // read/write calls on Linux, all I/O operations on Windows
+};
+
+// Whether a failure under the exec_limits memory limit was out of memory. `killed` is reported by the cgroup's OOM
+// killer; `possibly` is a heuristic: peak job memory near the limit on Windows, and under RLIMIT_AS a death by
+// SIGKILL/SIGSEGV/SIGABRT or an allocation failure on stderr.
+enum class out_of_memory { no, possibly, killed };
 
 struct exec_result {
     unsigned long exit_code = 1;
     std::string   std_out;
+    io_counters   io; // Windows only fills this in when capture_stdout is false
+    out_of_memory oom = out_of_memory::no;
+};
+
+// Resources of every exec() with capture_stdout = false from now on; zeros mean unlimited.
+struct exec_limits {
+    unsigned           cpus         = 0; // the first `cpus` CPUs the harness itself may run on
+    unsigned long long memory_bytes = 0;
+};
+
+struct applied_limits {
+    std::string how;      // a job object on Windows; on Linux a cgroup v2 leaf, or sched_setaffinity + RLIMIT_AS
+    unsigned    cpus = 0; // CPUs actually granted, fewer than asked when the harness may run on fewer
 };
 
-exec_result exec(std::string_view cmd, bool capture_stdout = true);
+// On Linux the cgroup v2 leaf is used when the cpuset and memory controllers can be delegated to it, otherwise the
+// limits are set in the child with sched_setaffinity + RLIMIT_AS.
+applied_limits set_limits(const exec_limits & l);
+
+// An empty `cwd` runs the command in the current directory.
+exec_result exec(std::string_view cmd, bool capture_stdout = true, const std::filesystem::path & cwd = {});
+
+// Sets environment variables of the harness, which the exec()s in its scope inherit; the previous values (or their
+// absence) are restored on destruction.
+class scoped_env {
+  public:
+    scoped_env() = default;
+    ~scoped_env();
+    scoped_env(const scoped_env &)             = delete;
+    scoped_env & operator=(const scoped_env &) = delete;
+
+    void set(std::string_view name, std::string_view value);
+
+  private:
+    std::vector<std::pair<std::string, std::optional<std::string>>> saved_;
+};
+
+// Path of the running harness binary.
+std::filesystem::path current_executable();
+
+// Resolves an executable name the same way exec() would, then follows symlinks to the actual binary.
+std::optional<std::filesystem::path> which(std::string_view exe);
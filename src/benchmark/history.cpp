@@ -0,0 +1,137 @@
+#include "history.hpp"
+
+#include "stats.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace history {
+// A change is only flagged when it is both statistically significant and large enough to matter.
+static constexpr double ALPHA      = 0.05;
+static constexpr double MIN_EFFECT = 0.03;
+
+static string field(string_view s) {
+    string out{s};
+    for(char & c : out)
+        if(c == '\t' || c == '\n' || c == '\r')
+            c = ' ';
+    return out;
+}
+
+static vector<string_view> split(string_view s, char sep) {
+    vector<string_view> out;
+    for(auto part : s | views::split(sep))
+        out.emplace_back(begin(part), end(part));
+    return out;
+}
+
+vector<entry> load(const filesystem::path & path) {
+    vector<entry> es;
+    ifstream      in{path};
+    for(string line; getline(in, line);) {
+        if(line.empty() || line[0] == '#')
+            continue;
+        const auto fs = split(line, '\t');
+        if(fs.size() != 6)
+            continue;
+
+        entry e{.run = string{fs[0]}, .host = string{fs[1]}, .lang = string{fs[2]}, .version = string{fs[3]}};
+        from_chars(fs[4].data(), fs[4].data() + fs[4].size(), e.num_fns);
+        for(auto s : split(fs[5], ',')) {
+            double v = 0.0;
+            if(from_chars(s.data(), s.data() + s.size(), v).ec == errc{})
+                e.samples_ms.push_back(v);
+        }
+        es.push_back(std::move(e));
+    }
+    return es;
+}
+
+void append(const filesystem::path & path, span<const entry> es, string_view comment) {
+    const bool fresh = !filesystem::exists(path);
+    ofstream   out{path, ios::app};
+    if(fresh)
+        out << "# run\thost\tlang\tversion\tnum_fns\tsamples_ms\n";
+    if(!comment.empty())
+        out << format("# {}\n", field(comment));
+    for(auto & e : es) {
+        string samples;
+        for(double s : e.samples_ms)
+            samples += format("{}{:.3f}", samples.empty() ? "" : ",", s);
+        out << format("{}\t{}\t{}\t{}\t{}\t{}\n",
+                      field(e.run),
+                      field(e.host),
+                      field(e.lang),
+                      field(e.version),
+                      e.num_fns,
+                      samples);
+    }
+}
+
+vector<change> compare(span<const entry> past, span<const entry> current) {
+    vector<change> cs;
+    for(auto & cur : current) {
+        if(cur.samples_ms.empty())
+            continue;
+        auto same_key = [&](const entry & e) {
+            return e.host == cur.host && e.lang == cur.lang && e.num_fns == cur.num_fns && !e.samples_ms.empty() &&
+                   e.run != cur.run;
+        };
+        const auto prev = ranges::find_if(past | views::reverse, same_key);
+        if(prev == ranges::end(past | views::reverse))
+            continue;
+
+        change c{.lang        = cur.lang,
+                 .num_fns     = cur.num_fns,
+                 .old_version = prev->version,
+                 .new_version = cur.version,
+                 .old_ms      = stats::median(prev->samples_ms),
+                 .new_ms      = stats::median(cur.samples_ms),
+                 .p_value     = stats::mann_whitney_p(prev->samples_ms, cur.samples_ms)};
+        const double rel = c.old_ms > 0.0 ? c.new_ms / c.old_ms - 1.0 : 0.0;
+        if(c.p_value < ALPHA && abs(rel) >= MIN_EFFECT)
+            c.v = rel > 0.0 ? verdict::regression : verdict::improvement;
+        cs.push_back(std::move(c));
+    }
+    return cs;
+}
+
+string md_changes(span<const change> cs, string_view caption) {
+    string s;
+    if(!caption.empty())
+        s += format("{}\n\n", caption);
+
+    auto flagged = cs | views::filter([](const change & c) { return c.v != verdict::same; });
+    if(ranges::empty(flagged)) {
+        s += cs.empty() ? "_No baseline for this host yet._\n" : "_No significant changes._\n";
+        return s;
+    }
+
+    s += format("_Mann-Whitney U, p < {}, |change| >= {:.0f}%_\n\n", ALPHA, MIN_EFFECT * 100.0);
+    s += "| Language | Functions | Baseline version | Current version | Baseline ms | Current ms | Change | p | |\n";
+    s += "|---|---:|---|---|---:|---:|---:|---:|---|\n";
+    for(auto & c : flagged)
+        s += format("| {} | {} | `{}` | `{}` | {:.3f} | {:.3f} | {:+.1f}% | {:.3f} | {} |\n",
+                    c.lang,
+                    c.num_fns,
+                    c.old_version,
+                    c.new_version,
+                    c.old_ms,
+                    c.new_ms,
+                    (c.new_ms / c.old_ms - 1.0) * 100.0,
+                    c.p_value,
+                    c.v == verdict::regression ? "regression" : "improvement");
+    return s;
+}
+
+} // namespace history
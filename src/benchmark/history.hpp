@@ -0,0 +1,43 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace history {
+
+// One (language, size) result of a sweep, keyed by the toolchain version it was measured with.
+struct entry {
+    std::string         run; // UTC timestamp of the sweep
+    std::string         host;
+    std::string         lang;
+    std::string         version;
+    int                 num_fns = 0;
+    std::vector<double> samples_ms;
+};
+
+enum class verdict { same, regression, improvement };
+
+struct change {
+    std::string lang;
+    int         num_fns = 0;
+    std::string old_version;
+    std::string new_version;
+    double      old_ms  = 0.0;
+    double      new_ms  = 0.0;
+    double      p_value = 1.0;
+    verdict     v       = verdict::same;
+};
+
+std::vector<entry> load(const std::filesystem::path & path);
+
+// `comment` (e.g. the machine fingerprint) is recorded alongside the entries but ignored by load().
+void append(const std::filesystem::path & path, std::span<const entry> es, std::string_view comment = {});
+
+// Compares each current entry against the most recent earlier entry for the same host, language and size.
+std::vector<change> compare(std::span<const entry> past, std::span<const entry> current);
+std::string         md_changes(std::span<const change> cs, std::string_view caption);
+
+} // namespace history
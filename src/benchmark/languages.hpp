@@ -1,51 +1,113 @@
 #pragma once
 
+#include "timings.hpp"
+
+#include <cstddef>
+
 // Disable stuff slow by moving it after Count
-enum Lang { Jai, Cpp, CSharp, Lua, JavaScript, Perl, Python, Odin, Tcc, Count, Zig, Rust };
+#ifdef _WIN32
+enum Lang { Jai, Cpp, CSharp, Lua, JavaScript, Perl, Python, Odin, Tcc, Count, Zig, Rust, Gcc, Clang };
+#else
+enum Lang { Gcc, Clang, Tcc, Lua, JavaScript, Perl, Python, Count, Jai, Cpp, CSharp, Odin, Zig, Rust };
+#endif
 
+// Function takes the index as {0}, the return value as {1} and the BodyStmt lines before the return as {2}.
+// BodyStmt takes the statement index as {0} and a value as {1}.
 template <Lang>
 struct LangSpec;
 
 template <>
 struct LangSpec<Lang::Cpp> {
     static constexpr char MainStart[]  = "int main() {\nint sum = 0;";
-    static constexpr char Function[]   = "int f{}() {{ return {}; }}";
+    static constexpr char Function[]   = "int f{0}() {{ {2}return {1}; }}";
+    static constexpr char BodyStmt[]   = "int v{0} = {1}; ";
     static constexpr char SumStmt[]    = "sum += f{}();";
     static constexpr char MainEnd[]    = "return ((sum & 255) > 1000) ? 1 : 0;\n}";
     static constexpr char Ext[]        = ".cpp";
+    static constexpr char Comment[]    = "// {}";
     static constexpr char Cmd[]        = "cl /nologo /std:c++20 {}";
     static constexpr char VersionCmd[] = "cl";
+    static constexpr char TimingCmd[]  = "cl /nologo /std:c++20 /Bt+ {} /link /time";
+    static constexpr auto Timings      = timings::parse_cl;
 };
 
 
 template <>
 struct LangSpec<Lang::Tcc> {
     static constexpr char MainStart[]  = "int main() {\nint sum = 0;";
-    static constexpr char Function[]   = "int f{}() {{ return {}; }}";
+    static constexpr char Function[]   = "int f{0}() {{ {2}return {1}; }}";
+    static constexpr char BodyStmt[]   = "int v{0} = {1}; ";
     static constexpr char SumStmt[]    = "sum += f{}();";
     static constexpr char MainEnd[]    = "return ((sum & 255) > 1000) ? 1 : 0;\n}";
     static constexpr char Ext[]        = ".c";
+    static constexpr char Comment[]    = "// {}";
+#ifdef _WIN32
     static constexpr char Cmd[]        = R"(tcc -I"C:\Program Files\tcc" -L"C:\Program Files\tcc" {})";
     static constexpr char VersionCmd[] = "tcc -version";
+#else
+    static constexpr char Cmd[]        = "tcc -o bench {}";
+    static constexpr char VersionCmd[] = "tcc -v";
+#endif
+};
+
+// Linux toolchains sweep over the linker too: Cmd takes the source as {0} and the -fuse-ld= value as {1}.
+// CompileCmd stops before linking, so link time can be told apart from the rest.
+template <>
+struct LangSpec<Lang::Gcc> {
+    static constexpr char         MainStart[]  = "int main() {\nint sum = 0;";
+    static constexpr char         Function[]   = "int f{0}() {{ {2}return {1}; }}";
+    static constexpr char         BodyStmt[]   = "int v{0} = {1}; ";
+    static constexpr char         SumStmt[]    = "sum += f{}();";
+    static constexpr char         MainEnd[]    = "return ((sum & 255) > 1000) ? 1 : 0;\n}";
+    static constexpr char         Ext[]        = ".c";
+    static constexpr char         Comment[]    = "// {}";
+    static constexpr char         Cmd[]        = "gcc -O0 -g -fuse-ld={1} -o bench {0}";
+    static constexpr char         CompileCmd[] = "gcc -O0 -g -c -o bench.o {0}";
+    static constexpr char         VersionCmd[] = "gcc --version";
+    static constexpr char         TimingCmd[]  = "gcc -O0 -g -c -ftime-report -o bench.o {}";
+    static constexpr auto         Timings      = timings::parse_gcc;
+    static constexpr const char * Linkers[]    = {"bfd", "gold", "lld", "mold"};
+};
+
+template <>
+struct LangSpec<Lang::Clang> {
+    static constexpr char         MainStart[]  = "int main() {\nint sum = 0;";
+    static constexpr char         Function[]   = "int f{0}() {{ {2}return {1}; }}";
+    static constexpr char         BodyStmt[]   = "int v{0} = {1}; ";
+    static constexpr char         SumStmt[]    = "sum += f{}();";
+    static constexpr char         MainEnd[]    = "return ((sum & 255) > 1000) ? 1 : 0;\n}";
+    static constexpr char         Ext[]        = ".c";
+    static constexpr char         Comment[]    = "// {}";
+    static constexpr char         Cmd[]        = "clang -O0 -g -fuse-ld={1} -o bench {0}";
+    static constexpr char         CompileCmd[] = "clang -O0 -g -c -o bench.o {0}";
+    static constexpr char         VersionCmd[] = "clang --version";
+    static constexpr char         TimingCmd[]  = "clang -O0 -g -c -ftime-report -o bench.o {}";
+    static constexpr auto         Timings      = timings::parse_clang;
+    static constexpr const char * Linkers[]    = {"bfd", "gold", "lld", "mold"};
 };
 
+// CacheEnv names the environment variables that point a toolchain's caches somewhere else, so the cache modes can
+// hand it a fresh or a primed directory.
 template <>
 struct LangSpec<Lang::Zig> {
-    static constexpr char MainStart[]  = R"d(
+    static constexpr char         MainStart[]  = R"d(
 pub fn main() u8 {
     var sum: u32 = 0;
 )d";
-    static constexpr char Function[]   = R"d(
-fn f_{}() u32 {{
-    return {};
+    static constexpr char         Function[]   = R"d(
+fn f_{0}() u32 {{
+{2}    return {1};
 }})d";
-    static constexpr char SumStmt[]    = "sum += f_{}();";
-    static constexpr char MainEnd[]    = R"d(
+    static constexpr char         BodyStmt[]   = "    const v{0}: u32 = {1};\n    _ = v{0};\n";
+    static constexpr char         SumStmt[]    = "sum += f_{}();";
+    static constexpr char         MainEnd[]    = R"d(
     return if ((sum & 0xff) > 1000) 1 else 0;
 })d";
-    static constexpr char Ext[]        = ".zig";
-    static constexpr char Cmd[]        = "zig build-exe -ODebug {}";
-    static constexpr char VersionCmd[] = "zig version";
+    static constexpr char         Ext[]        = ".zig";
+    static constexpr char         Comment[]    = "// {}";
+    static constexpr char         Cmd[]        = "zig build-exe -ODebug {}";
+    static constexpr char         VersionCmd[] = "zig version";
+    static constexpr const char * CacheEnv[]   = {"ZIG_GLOBAL_CACHE_DIR", "ZIG_LOCAL_CACHE_DIR"};
 };
 
 template <>
@@ -54,23 +116,32 @@ struct LangSpec<Lang::CSharp> {
     static constexpr char MainStart[]  = R"d(
   public static int Main() {
     int sum = 0;)d";
-    static constexpr char Function[]   = "  static int f{}() {{ return {}; }}";
+    static constexpr char Function[]   = "  static int f{0}() {{ {2}return {1}; }}";
+    static constexpr char BodyStmt[]   = "int v{0} = {1}; ";
     static constexpr char SumStmt[]    = "    sum += f{}();";
     static constexpr char MainEnd[]    = "    return ((sum & 255) > 1000) ? 1 : 0;\n  }\n}";
     static constexpr char Ext[]        = ".cs";
+    static constexpr char Comment[]    = "// {}";
     static constexpr char Cmd[]        = "csc -optimize- -nologo {}";
     static constexpr char VersionCmd[] = "csc -version";
 };
 
 template <>
-struct LangSpec<Lang::Lua> {
-    static constexpr char MainStart[]  = "\nlocal sum = 0";
-    static constexpr char Function[]   = "function f{}() return {} end";
-    static constexpr char SumStmt[]    = "sum = sum + f{}()";
-    static constexpr char MainEnd[]    = "os.exit(((sum % 256) > 1000) and 1 or 0)";
-    static constexpr char Ext[]        = ".lua";
-    static constexpr char Cmd[]        = "luajit {}";
-    static constexpr char VersionCmd[] = "luajit -v";
+struct LangSpec<Lang::Lua> { // LuaJIT keeps no cache between runs, so there is no CacheEnv
+    static constexpr char MainStart[]      = "\nlocal sum = 0";
+    static constexpr char Function[]       = "function f{0}() {2}return {1} end";
+    static constexpr char BodyStmt[]       = "local v{0} = {1} ";
+    static constexpr char SumStmt[]        = "sum = sum + f{}()";
+    static constexpr char MainEnd[]        = "os.exit(((sum % 256) > 1000) and 1 or 0)";
+    static constexpr char Ext[]            = ".lua";
+    static constexpr char Comment[]        = "-- {}";
+    static constexpr char Cmd[]            = "luajit {}";
+    static constexpr char PrecompileCmd[]  = "luajit -b {0} {1}";
+    static constexpr char Precompiled[]    = "bench.ljbc";
+    static constexpr char PrecompiledCmd[] = "luajit {}";
+    static constexpr char VersionCmd[]     = "luajit -v";
+
+    static constexpr unsigned MaxBodyStmts = 199; // BodyStmt declares a local, and a function may have at most 200
 };
 
 template <>
@@ -79,49 +150,80 @@ struct LangSpec<Lang::Rust> {
 fn main() {
   let mut sum: i32 = 0;
 )d";
-    static constexpr char Function[]   = "fn f{}() -> i32 {{ {} }}";
+    static constexpr char Function[]   = "fn f{0}() -> i32 {{ {2}{1} }}";
+    static constexpr char BodyStmt[]   = "let _v{0} = {1}; ";
     static constexpr char SumStmt[]    = "  sum += f{}();";
     static constexpr char MainEnd[]    = R"d(
   std::process::exit(if (sum & 255) > 1000 { 1 } else { 0 });
 }
 )d";
     static constexpr char Ext[]        = ".rs";
+    static constexpr char Comment[]    = "// {}";
     static constexpr char Cmd[]        = "rustc --edition=2024 -C opt-level=0 {}";
     static constexpr char VersionCmd[] = "rustc -V";
+    static constexpr char TimingCmd[]  = "rustc --edition=2024 -C opt-level=0 -Z time-passes {}"; // nightly only
+    static constexpr auto Timings      = timings::parse_rustc;
 };
 
 template <>
 struct LangSpec<Lang::JavaScript> {
-    static constexpr char MainStart[]  = R"d(
+    static constexpr char         MainStart[]      = R"d(
 let sum = 0;)d";
-    static constexpr char Function[]   = "function f{}() {{ return {}; }}";
-    static constexpr char SumStmt[]    = "sum += f{}();";
-    static constexpr char MainEnd[]    = "Deno.exit(((sum & 255) > 1000) ? 1 : 0);";
-    static constexpr char Ext[]        = ".js";
-    static constexpr char Cmd[]        = "deno {}";
-    static constexpr char VersionCmd[] = "deno --version";
+    static constexpr char         Function[]       = "function f{0}() {{ {2}return {1}; }}";
+    static constexpr char         BodyStmt[]       = "let v{0} = {1}; ";
+    static constexpr char         SumStmt[]        = "sum += f{}();";
+    static constexpr char         MainEnd[]        = "Deno.exit(((sum & 255) > 1000) ? 1 : 0);";
+    static constexpr char         Ext[]            = ".js";
+    static constexpr char         Comment[]        = "// {}";
+    static constexpr char         Cmd[]            = "deno {}";
+    static constexpr char         PrecompileCmd[]  = "deno compile -o {1} {0}"; // a standalone binary, V8 snapshot
+#ifdef _WIN32
+    static constexpr char         Precompiled[]    = "bench_deno.exe";
+    static constexpr char         PrecompiledCmd[] = "{}";
+#else
+    static constexpr char         Precompiled[]    = "bench_deno";
+    static constexpr char         PrecompiledCmd[] = "./{}";
+#endif
+    static constexpr char         VersionCmd[]     = "deno --version";
+    static constexpr const char * CacheEnv[]       = {"DENO_DIR"};
 };
 
 template <>
-struct LangSpec<Lang::Perl> {
+struct LangSpec<Lang::Perl> { // no maintained bytecode compiler since B::Bytecode was dropped, so no PrecompileCmd
     static constexpr char MainStart[]  = "my $sum = 0;\n";
-    static constexpr char Function[]   = "sub f{} {{ {} }}";
+    static constexpr char Function[]   = "sub f{0} {{ {2}{1} }}";
+    static constexpr char BodyStmt[]   = "my $v{0} = {1}; ";
     static constexpr char SumStmt[]    = "$sum += f{}();";
     static constexpr char MainEnd[]    = "exit((($sum & 255) > 1000) ? 1 : 0);";
     static constexpr char Ext[]        = ".pl";
+    static constexpr char Comment[]    = "# {}";
     static constexpr char Cmd[]        = "perl {}";
     static constexpr char VersionCmd[] = "perl -v";
 };
 
 template <>
-struct LangSpec<Lang::Python> {
-    static constexpr char MainStart[]  = "sum = 0";
-    static constexpr char Function[]   = "def f{}():\n  return {}";
-    static constexpr char SumStmt[]    = "sum += f{}()";
-    static constexpr char MainEnd[]    = "raise SystemExit(1 if (sum & 255) > 1000 else 0)";
-    static constexpr char Ext[]        = ".py";
-    static constexpr char Cmd[]        = "python {}";
-    static constexpr char VersionCmd[] = "python --version";
+struct LangSpec<Lang::Python> { // no bytecode is written for the script run as __main__, so there is no CacheEnv
+    static constexpr char MainStart[]      = "sum = 0";
+    static constexpr char Function[]       = "def f{0}():\n{2}  return {1}";
+    static constexpr char BodyStmt[]       = "  v{0} = {1}\n";
+    static constexpr char SumStmt[]        = "sum += f{}()";
+    static constexpr char MainEnd[]        = "raise SystemExit(1 if (sum & 255) > 1000 else 0)";
+    static constexpr char Ext[]            = ".py";
+    static constexpr char Comment[]        = "# {}";
+#ifdef _WIN32
+    static constexpr char Cmd[]            = "python {}";
+    static constexpr char PrecompileCmd[] =
+      R"d(python -c "import py_compile; py_compile.compile('{0}', '{1}', doraise=True)")d";
+    static constexpr char PrecompiledCmd[] = "python {}";
+    static constexpr char VersionCmd[]     = "python --version";
+#else
+    static constexpr char Cmd[]            = "python3 {}";
+    static constexpr char PrecompileCmd[] =
+      R"d(python3 -c "import py_compile; py_compile.compile('{0}', '{1}', doraise=True)")d";
+    static constexpr char PrecompiledCmd[] = "python3 {}";
+    static constexpr char VersionCmd[]     = "python3 --version";
+#endif
+    static constexpr char Precompiled[]    = "bench.pyc";
 };
 
 template <>
@@ -130,13 +232,17 @@ struct LangSpec<Lang::Odin> {
     static constexpr char MainStart[]  = R"d(
 main :: proc() {
     sum : i32 = 0)d";
-    static constexpr char Function[]   = "f{} :: proc() -> i32 {{ return {} }}";
+    static constexpr char Function[]   = "f{0} :: proc() -> i32 {{ {2}return {1} }}";
+    static constexpr char BodyStmt[]   = "v{0} := i32({1}); _ = v{0}; ";
     static constexpr char SumStmt[]    = "    sum += f{}()";
     static constexpr char MainEnd[]    = R"d(
 })d";
     static constexpr char Ext[]        = ".odin";
+    static constexpr char Comment[]    = "// {}";
     static constexpr char Cmd[]        = "odin build {} -file";
     static constexpr char VersionCmd[] = "odin version";
+    static constexpr char TimingCmd[]  = "odin build {} -file -show-timings";
+    static constexpr auto Timings      = timings::parse_odin;
 };
 
 template <>
@@ -146,16 +252,20 @@ main :: () {
 sum : s32 = 0;
 )d";
     static constexpr char Function[]   = R"d(
-f{} :: () -> s32 {{ 
-    return {};
+f{0} :: () -> s32 {{ 
+{2}    return {1};
 }}
 )d";
+    static constexpr char BodyStmt[]   = "    v{0} : s32 = {1};\n";
     static constexpr char SumStmt[]    = "sum += f{}();";
     static constexpr char MainEnd[]    = R"d(
 })d";
     static constexpr char Ext[]        = ".jai";
+    static constexpr char Comment[]    = "// {}";
     static constexpr char Cmd[]        = "jai.exe -quiet -exe bench -x64 {}";
     static constexpr char VersionCmd[] = "jai.exe -version";
+    static constexpr char TimingCmd[]  = "jai.exe -exe bench -x64 {}"; // not -quiet, so it prints its metrics
+    static constexpr auto Timings      = timings::parse_jai;
 };
 
 constexpr const char * gh_color(Lang l) {
@@ -181,7 +291,18 @@ constexpr const char * gh_color(Lang l) {
         return "#60affe";
     case Lang::Jai:
         return "#d5a021";
+    case Lang::Gcc:
+        return "#555555"; // C
+    case Lang::Clang:
+        return "#f34b7d"; // C++, there's no separate one for clang
     default:
         return "#9ca3af"; // gray-400
     }
 }
+
+constexpr const char * linker_color(Lang l, size_t linker) {
+    // Hue per compiler, shade per linker (bfd, gold, lld, mold).
+    constexpr const char * warm[] = {"#7f1d1d", "#dc2626", "#f97316", "#facc15"};
+    constexpr const char * cool[] = {"#1e3a8a", "#2563eb", "#06b6d4", "#a78bfa"};
+    return (l == Lang::Clang ? cool : warm)[linker % 4];
+}
@@ -0,0 +1,164 @@
+#include "stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <span>
+#include <vector>
+
+using namespace std;
+
+namespace stats {
+
+double median(span<const double> xs) {
+    if(xs.empty())
+        return 0.0;
+    vector<double> v{begin(xs), end(xs)};
+    ranges::sort(v);
+    const size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) * 0.5;
+}
+
+double percentile(span<const double> xs, double p) {
+    if(xs.empty())
+        return 0.0;
+    vector<double> v{begin(xs), end(xs)};
+    ranges::sort(v);
+    const double r  = clamp(p, 0.0, 1.0) * double(v.size() - 1);
+    const size_t lo = size_t(r);
+    const size_t hi = min(lo + 1, v.size() - 1);
+    return v[lo] + (v[hi] - v[lo]) * (r - double(lo));
+}
+
+interval median_ci(span<const double> xs, double confidence) {
+    if(xs.empty())
+        return {};
+    vector<double> v{begin(xs), end(xs)};
+    ranges::sort(v);
+    const size_t n = v.size();
+
+    // The interval [x_(j), x_(n+1-j)] misses the median with probability 2 * P(Binomial(n, 1/2) < j).
+    auto miss = [&](size_t j) {
+        double p = 0.0, c = 1.0; // c = n choose i
+        for(size_t i = 0; i < j; ++i) {
+            p += c;
+            c = c * double(n - i) / double(i + 1);
+        }
+        return 2.0 * p / pow(2.0, double(n));
+    };
+    size_t j = 1;
+    while(j + 1 <= n / 2 && 1.0 - miss(j + 1) >= confidence)
+        ++j;
+    return {v[j - 1], v[n - j]};
+}
+
+ratio paired_ratio(span<const double> a, span<const double> b) {
+    // Two-sided 95% quantiles of Student's t for 1..30 degrees of freedom; normal beyond.
+    static constexpr double T95[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                     2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                     2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+    vector<double> logs;
+    for(size_t i = 0; i < min(a.size(), b.size()); ++i)
+        if(a[i] > 0.0 && b[i] > 0.0)
+            logs.push_back(log(a[i] / b[i]));
+    if(logs.empty())
+        return {};
+
+    const double n    = double(logs.size());
+    double       mean = 0.0, var = 0.0;
+    for(double l : logs)
+        mean += l / n;
+    for(double l : logs)
+        var += (l - mean) * (l - mean) / max(n - 1.0, 1.0);
+
+    const size_t df   = logs.size() - 1;
+    const double t    = df == 0 ? 0.0 : df <= size(T95) ? T95[df - 1] : 1.96;
+    const double half = t * sqrt(var / n);
+    return {exp(mean), {exp(mean - half), exp(mean + half)}};
+}
+
+optional<plane> fit_plane(span<const double> x1, span<const double> x2, span<const double> y) {
+    const size_t n = min({x1.size(), x2.size(), y.size()});
+    if(n < 3)
+        return nullopt;
+
+    // Centered and scaled, the normal equations stay well conditioned even when x2 is ~1e6 times x1, and the intercept
+    // drops out. What remains is 2x2, with x1 and x2 as unit-variance columns.
+    auto mean = [n](span<const double> xs) { return accumulate(xs.begin(), xs.begin() + ptrdiff_t(n), 0.0) / n; };
+    const double m1 = mean(x1), m2 = mean(x2), my = mean(y);
+    double       s1 = 0.0, s2 = 0.0;
+    for(size_t i = 0; i < n; ++i) {
+        s1 += (x1[i] - m1) * (x1[i] - m1);
+        s2 += (x2[i] - m2) * (x2[i] - m2);
+    }
+    s1 = sqrt(s1 / double(n));
+    s2 = sqrt(s2 / double(n));
+    if(s1 == 0.0 || s2 == 0.0)
+        return nullopt;
+
+    double uu = 0.0, uv = 0.0, vv = 0.0, uy = 0.0, vy = 0.0;
+    for(size_t i = 0; i < n; ++i) {
+        const double u = (x1[i] - m1) / s1, v = (x2[i] - m2) / s2, w = y[i] - my;
+        uu += u * u;
+        uv += u * v;
+        vv += v * v;
+        uy += u * w;
+        vy += v * w;
+    }
+    // det / (uu * vv) is 1 - r^2 of x1 and x2: near 0 they don't vary independently.
+    const double det = uu * vv - uv * uv;
+    if(det <= 1e-9 * uu * vv)
+        return nullopt;
+
+    const double c1 = (vv * uy - uv * vy) / det / s1;
+    const double c2 = (uu * vy - uv * uy) / det / s2;
+    return plane{my - c1 * m1 - c2 * m2, c1, c2};
+}
+
+double mann_whitney_p(span<const double> a, span<const double> b) {
+    const size_t n1 = a.size(), n2 = b.size();
+    if(!n1 || !n2)
+        return 1.0;
+
+    struct ranked {
+        double x;
+        bool   from_a;
+    };
+    vector<ranked> all;
+    all.reserve(n1 + n2);
+    for(double x : a)
+        all.push_back({x, true});
+    for(double x : b)
+        all.push_back({x, false});
+    ranges::sort(all, {}, &ranked::x);
+
+    // Average ranks over ties; accumulate the tie correction term sum(t^3 - t).
+    double r1 = 0.0, ties = 0.0;
+    for(size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while(j < all.size() && all[j].x == all[i].x)
+            ++j;
+        const double rank = (double(i + 1) + double(j)) * 0.5;
+        for(size_t k = i; k < j; ++k)
+            if(all[k].from_a)
+                r1 += rank;
+        const double t = double(j - i);
+        ties += t * t * t - t;
+        i = j;
+    }
+
+    const double n   = double(n1 + n2);
+    const double u1  = r1 - double(n1) * double(n1 + 1) * 0.5;
+    const double mu  = double(n1) * double(n2) * 0.5;
+    const double var = double(n1) * double(n2) / 12.0 * ((n + 1.0) - ties / (n * (n - 1.0)));
+    if(var <= 0.0)
+        return 1.0;
+
+    // Continuity correction towards the mean.
+    const double d = max(0.0, abs(u1 - mu) - 0.5);
+    const double z = d / sqrt(var);
+    return erfc(z / sqrt(2.0));
+}
+
+} // namespace stats
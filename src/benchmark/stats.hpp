@@ -0,0 +1,40 @@
+#pragma once
+
+#include <optional>
+#include <span>
+
+namespace stats {
+
+struct interval {
+    double lo = 0.0;
+    double hi = 0.0;
+};
+
+double median(std::span<const double> xs);
+
+// Interpolates between the order statistics; p in [0, 1].
+double percentile(std::span<const double> xs, double p);
+
+// Distribution-free confidence interval of the median from order statistics. With 5 samples it's [min, max] at 94%,
+// the best any 5 samples can do.
+interval median_ci(std::span<const double> xs, double confidence = 0.95);
+
+// Geometric mean of the paired ratios a[i] / b[i] with its 95% t-interval.
+struct ratio {
+    double   estimate = 1.0;
+    interval ci{1.0, 1.0};
+};
+ratio paired_ratio(std::span<const double> a, std::span<const double> b);
+
+// Least-squares fit of y = c0 + c1 * x1 + c2 * x2; nullopt when x1 and x2 don't vary independently.
+struct plane {
+    double c0 = 0.0;
+    double c1 = 0.0;
+    double c2 = 0.0;
+};
+std::optional<plane> fit_plane(std::span<const double> x1, std::span<const double> x2, std::span<const double> y);
+
+// Two-sided p-value of the Mann-Whitney U test (normal approximation with tie correction).
+double mann_whitney_p(std::span<const double> a, std::span<const double> b);
+
+} // namespace stats
@@ -0,0 +1,192 @@
+#include "timings.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <optional>
+#include <ranges>
+#include <string_view>
+
+using namespace std;
+
+namespace timings {
+namespace {
+void add(optional<double> & phase, double ms) { phase = phase.value_or(0.0) + ms; }
+
+bool contains(string_view s, string_view what) { return s.find(what) != string_view::npos; }
+
+// Parses the number starting at or after `from`, followed by an optional unit (s, ms, us); returns ms.
+optional<double> parse_time(string_view s, size_t from = 0) {
+    const size_t at = s.find_first_of("0123456789", from);
+    if(at == string_view::npos)
+        return nullopt;
+    double     v   = 0.0;
+    const auto res = from_chars(s.data() + at, s.data() + s.size(), v);
+    if(res.ec != errc{})
+        return nullopt;
+    string_view unit = s.substr(size_t(res.ptr - s.data()));
+    unit.remove_prefix(min(unit.find_first_not_of(' '), unit.size()));
+    if(unit.starts_with("ms"))
+        return v;
+    if(unit.starts_with("us"))
+        return v / 1000.0;
+    return v * 1000.0; // seconds
+}
+
+auto lines(string_view out) {
+    return out | views::split('\n') | views::transform([](auto r) { return string_view{begin(r), end(r)}; });
+}
+} // namespace
+
+phases parse_cl(string_view out) {
+    // time(C:\...\c1xx.dll)=0.31204s < 1234 - 5678 > BB [bench.cpp]
+    // Final: Total time = 0.07129s
+    phases p;
+    for(const auto line : lines(out)) {
+        const size_t eq = line.find(")=");
+        if(line.starts_with("time(") && eq != string_view::npos) {
+            const auto t = parse_time(line, eq + 2);
+            if(!t)
+                continue;
+            if(contains(line, "c1xx.dll") || contains(line, "c1.dll"))
+                add(p.frontend, *t);
+            else if(contains(line, "c2.dll"))
+                add(p.codegen, *t);
+            else if(contains(line, "link.exe"))
+                add(p.link, *t);
+        } else if(contains(line, "Total time =") && !p.link) {
+            if(const auto t = parse_time(line, line.find('=')))
+                add(p.link, *t);
+        }
+    }
+    return p;
+}
+
+phases parse_rustc(string_view out) {
+    // time:   0.003; rss:   32MB ->   35MB (   +3MB)	parse_crate
+    // Only top-level passes, so nested ones aren't counted twice.
+    phases p;
+    for(const auto line : lines(out)) {
+        if(!line.starts_with("time:"))
+            continue;
+        const auto t = parse_time(line);
+        if(!t)
+            continue;
+        const auto pass = line.substr(line.find_last_of(" \t") + 1);
+        if(pass == "parse_crate" || pass == "expand_crate")
+            add(p.frontend, *t);
+        else if(pass == "type_check_crate" || pass == "MIR_borrow_checking")
+            add(p.typecheck, *t);
+        else if(pass == "codegen_crate" || pass == "LLVM_passes")
+            add(p.codegen, *t);
+        else if(pass == "link")
+            add(p.link, *t);
+    }
+    return p;
+}
+
+phases parse_odin(string_view out) {
+    // parse files          -    12.345 ms -   4.56%
+    phases p;
+    for(const auto line : lines(out)) {
+        const size_t dash = line.find(" - ");
+        if(dash == string_view::npos)
+            continue;
+        const auto t = parse_time(line, dash + 3);
+        if(!t)
+            continue;
+        const auto name = line.substr(0, dash);
+        if(contains(name, "parse"))
+            add(p.frontend, *t);
+        else if(contains(name, "type check") || contains(name, "checker"))
+            add(p.typecheck, *t);
+        else if(contains(name, "LLVM") || contains(name, "Code Gen") || contains(name, "code gen"))
+            add(p.codegen, *t);
+        else if(contains(name, "link"))
+            add(p.link, *t);
+    }
+    return p;
+}
+
+phases parse_jai(string_view out) {
+    // Front-end time: 0.085 seconds.
+    // x64      time: 0.036 seconds.
+    // Link     time: 0.040 seconds.
+    phases p;
+    for(const auto line : lines(out)) {
+        const size_t colon = line.find("time:");
+        if(colon == string_view::npos)
+            continue;
+        const auto t = parse_time(line, colon + 5);
+        if(!t)
+            continue;
+        const auto name = line.substr(0, colon);
+        if(contains(name, "Front"))
+            add(p.frontend, *t);
+        else if(contains(name, "x64") || contains(name, "llvm") || contains(name, "LLVM"))
+            add(p.codegen, *t);
+        else if(contains(name, "Link"))
+            add(p.link, *t);
+    }
+    return p;
+}
+
+phases parse_gcc(string_view out) {
+    // Time variable                                   usr           sys          wall           GGC
+    //  phase parsing                      :   0.03 ( 60%)   0.01 ( 50%)   0.04 ( 57%)  7000k ( 62%)
+    // Only the "phase" rows, which partition the total; the rest are nested in them.
+    phases p;
+    for(const auto line : lines(out)) {
+        const size_t colon = line.find(':');
+        if(!line.starts_with(" phase ") || colon == string_view::npos)
+            continue;
+        size_t wall = colon; // third column, after the usr and sys percentages
+        for(int i = 0; i < 2 && wall != string_view::npos; ++i)
+            wall = line.find("%)", wall + 1);
+        const auto t = wall == string_view::npos ? nullopt : parse_time(line, wall + 2);
+        if(!t)
+            continue;
+        const auto name = line.substr(0, colon);
+        if(contains(name, "parsing") || contains(name, "lang. deferred"))
+            add(p.frontend, *t);
+        else if(contains(name, "opt and generate") || contains(name, "finalize"))
+            add(p.codegen, *t);
+    }
+    return p;
+}
+
+phases parse_clang(string_view out) {
+    //                         Miscellaneous Ungrouped Timers      (or "Clang time report" since clang 19)
+    //    ---User Time---   --System Time--   --User+System--   ---Wall Time---  --- Name ---
+    //    0.0079 ( 57.5%)   0.0049 ( 60.2%)   0.0128 ( 58.3%)   0.0128 ( 58.3%)  Code Generation Time
+    // The per-pass reports use the same layout, so only the summary sections are read.
+    phases      p;
+    string_view section, previous;
+    bool        in_title = false; // section titles sit between a pair of ===--- rules
+    for(const auto line : lines(out)) {
+        if(line.starts_with("===-")) {
+            in_title = !in_title;
+            if(!in_title)
+                section = previous;
+        }
+        previous = line;
+        if(!contains(section, "Ungrouped Timers") && !contains(section, "Clang time report"))
+            continue;
+        const size_t pct   = line.rfind("%)");
+        const size_t paren = pct == string_view::npos ? pct : line.rfind('(', pct);
+        if(paren == string_view::npos)
+            continue;
+        const size_t end = line.find_last_not_of(' ', paren - 1); // the wall time is the last number before it
+        const auto   t   = end == string_view::npos ? nullopt : parse_time(line, line.find_last_of(' ', end) + 1);
+        if(!t)
+            continue;
+        const auto name = line.substr(pct + 2);
+        if(contains(name, "Front end"))
+            add(p.frontend, *t);
+        else if(contains(name, "IR Generation") || contains(name, "IR generation") || contains(name, "Optimizer") ||
+                contains(name, "Code Generation") || contains(name, "code generation"))
+            add(p.codegen, *t);
+    }
+    return p;
+}
+
+} // namespace timings
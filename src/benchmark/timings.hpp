@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+// Parsers for the compilers' own per-phase timing reports. All times are in ms.
+namespace timings {
+
+struct phases {
+    std::optional<double> frontend; // parsing, macro expansion, name resolution
+    std::optional<double> typecheck;
+    std::optional<double> codegen;
+    std::optional<double> link;
+};
+
+inline constexpr std::array<std::pair<const char *, std::optional<double> phases::*>, 4> fields = {{
+  {"Frontend", &phases::frontend},
+  {"Typecheck", &phases::typecheck},
+  {"Codegen", &phases::codegen},
+  {"Link", &phases::link},
+}};
+
+using parser = phases (*)(std::string_view out);
+
+phases parse_cl(std::string_view out);    // cl /Bt+ ... /link /time
+phases parse_rustc(std::string_view out); // rustc -Z time-passes
+phases parse_odin(std::string_view out);  // odin build -show-timings
+phases parse_jai(std::string_view out);   // jai without -quiet
+phases parse_gcc(std::string_view out);   // gcc -ftime-report
+phases parse_clang(std::string_view out); // clang -ftime-report
+
+} // namespace timings
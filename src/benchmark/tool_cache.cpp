@@ -0,0 +1,39 @@
+#include "tool_cache.hpp"
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+namespace tool_cache {
+
+optional<string> key_of(const filesystem::path & binary) {
+    error_code ec;
+    const auto mtime = filesystem::last_write_time(binary, ec);
+    if(ec)
+        return nullopt;
+    const auto size = filesystem::file_size(binary, ec);
+    if(ec)
+        return nullopt;
+    return format("{}|{}|{}", binary.string(), mtime.time_since_epoch().count(), size);
+}
+
+table load(const filesystem::path & path) {
+    table    t;
+    ifstream in{path};
+    for(string line; getline(in, line);)
+        if(const auto tab = line.find('\t'); tab != string::npos)
+            t[line.substr(0, tab)] = line.substr(tab + 1);
+    return t;
+}
+
+void save(const filesystem::path & path, const table & t) {
+    ofstream out{path};
+    for(auto & [key, version] : t)
+        out << key << '\t' << version << '\n';
+}
+
+} // namespace tool_cache
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+
+namespace tool_cache {
+
+// Maps a binary's identity (canonical path, mtime and size) to its version line.
+using table = std::map<std::string, std::string>;
+
+std::optional<std::string> key_of(const std::filesystem::path & binary);
+
+table load(const std::filesystem::path & path);
+void  save(const std::filesystem::path & path, const table & t);
+
+} // namespace tool_cache
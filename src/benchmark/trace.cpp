@@ -0,0 +1,132 @@
+#include "trace.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace trace {
+namespace {
+struct state {
+    mutex                            m;
+    atomic<bool>                     enabled = false; // also read without m, to skip all work while tracing is off
+    filesystem::path                 path;
+    chrono::steady_clock::time_point origin;
+    vector<string>                   events;
+    map<thread::id, int>             tids;
+};
+state g;
+
+string json_str(string_view s) {
+    string out = "\"";
+    for(char c : s) {
+        switch(c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+        case '\t':
+            out += ' ';
+            break;
+        default:
+            if(static_cast<unsigned char>(c) < 0x20)
+                out += format("\\u{:04x}", c);
+            else
+                out += c;
+            break;
+        }
+    }
+    out += '"';
+    return out;
+}
+
+double us_since_origin(chrono::steady_clock::time_point t) {
+    return chrono::duration<double, micro>(t - g.origin).count();
+}
+
+// Small stable thread ids make the Perfetto tracks readable. Requires g.m to be held.
+int tid() {
+    const auto [it, _] = g.tids.try_emplace(this_thread::get_id(), int(g.tids.size()) + 1);
+    return it->second;
+}
+} // namespace
+
+void open(const filesystem::path & path) {
+    lock_guard lock{g.m};
+    g.enabled = true;
+    g.path    = path;
+    g.origin  = chrono::steady_clock::now();
+    g.events.clear();
+    g.events.push_back(R"({"name":"process_name","ph":"M","pid":1,"args":{"name":"lang_benchmark"}})");
+}
+
+void close() {
+    lock_guard lock{g.m};
+    if(!g.enabled)
+        return;
+    g.enabled = false;
+
+    ofstream out{g.path};
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    for(size_t i = 0; i < g.events.size(); ++i)
+        out << g.events[i] << (i + 1 < g.events.size() ? ",\n" : "\n");
+    out << "]}\n";
+    g.events.clear();
+}
+
+span::span(string_view name, args a) : enabled_{g.enabled} {
+    if(!enabled_)
+        return;
+    name_ = name;
+    for(auto & [k, v] : a)
+        args_ += format("{}{}:{}", args_.empty() ? "" : ",", json_str(k), json_str(v));
+    start_ = chrono::steady_clock::now();
+}
+
+span::~span() {
+    if(!enabled_)
+        return;
+    const auto end = chrono::steady_clock::now();
+    lock_guard lock{g.m};
+    if(!g.enabled)
+        return;
+    g.events.push_back(format(R"({{"name":{},"ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f},"args":{{{}}}}})",
+                              json_str(name_),
+                              tid(),
+                              us_since_origin(start_),
+                              chrono::duration<double, micro>(end - start_).count(),
+                              args_));
+}
+
+void counter(string_view name, initializer_list<pair<string_view, double>> series) {
+    if(!g.enabled)
+        return;
+    const auto now = chrono::steady_clock::now();
+    lock_guard lock{g.m};
+    if(!g.enabled)
+        return;
+    string values;
+    for(auto & [k, v] : series)
+        values += format("{}{}:{}", values.empty() ? "" : ",", json_str(k), v);
+    g.events.push_back(format(R"({{"name":{},"ph":"C","pid":1,"ts":{:.3f},"args":{{{}}}}})",
+                              json_str(name),
+                              us_since_origin(now),
+                              values));
+}
+
+} // namespace trace
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Chrome trace-event (Perfetto-compatible) writer. Everything is a no-op until open() is called.
+namespace trace {
+
+using args = std::initializer_list<std::pair<std::string_view, std::string>>;
+
+void open(const std::filesystem::path & path);
+void close(); // writes the file
+
+// Complete ("X") event spanning the lifetime of the object. While tracing is off it records and formats nothing.
+class span {
+  public:
+    explicit span(std::string_view name, args a = {});
+    ~span();
+    span(const span &)             = delete;
+    span & operator=(const span &) = delete;
+
+  private:
+    std::string                           name_;
+    std::string                           args_;
+    std::chrono::steady_clock::time_point start_;
+    bool                                  enabled_ = false;
+};
+
+// Counter ("C") event; each series is drawn as a separate track.
+void counter(std::string_view name, std::initializer_list<std::pair<std::string_view, double>> series);
+
+} // namespace trace